@@ -0,0 +1,216 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include "PriorityMutex.h"
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+//What push() does when a Bounded_Queue is full
+enum class Backpressure
+{
+    Block, //Wait until a pop makes room
+    Drop_Oldest, //Discard the front element
+    Fail //Reject the new element
+};
+
+/*!
+ * \brief Lock-free bounded multi-producer multi-consumer FIFO queue.
+ * The ring buffer is allocated once in the constructor, elements are constructed in place by push() and moved out by pop().
+ * Every slot carries a sequence number that tells producers and consumers whose turn it is (Vyukov's bounded queue),
+ * so a push and a pop only contend when they race for the same end of the queue.
+ * The capacity is rounded up to a power of two, and is at least 2.
+ */
+template<typename T>
+class Bounded_Queue
+{
+public:
+    explicit Bounded_Queue(std::size_t capacity);
+    ~Bounded_Queue();
+
+    template<typename U>
+    bool push(U &&IN_element, Backpressure policy); //retval false only with Backpressure::Fail and a full queue
+    template<typename U>
+    [[nodiscard]] bool try_push(U &&IN_element); //non-blocking. retval false if queue was full
+    //non-blocking. Empty if queue was empty. OUT_position receives the running index of the element, which grows by one per push
+    [[nodiscard]] std::optional<T> try_pop(std::size_t *OUT_position = nullptr);
+    [[nodiscard]] bool empty() const; //non-blocking
+    [[nodiscard]] std::size_t capacity() const { return mMask + 1; }
+
+    Bounded_Queue& operator =(const Bounded_Queue&) = delete;
+    Bounded_Queue(const Bounded_Queue&) = delete;
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> seq; //== position: free for that push, == position + 1: holds the element for that pop
+        alignas(T) std::byte storage[sizeof(T)];
+
+        T* element() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    static constexpr std::size_t CACHE_LINE_SIZE = NS_priority_mutex::NS_detail::CACHE_LINE_SIZE;
+
+    std::unique_ptr<Slot[]> mSlots;
+    std::size_t mMask;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mPush_pos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mPop_pos{0};
+    //Blocked pushers park on mPop_count. Pops only touch it while someone is blocked.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> mPop_count{0};
+    std::atomic<std::uint32_t> mBlocked_pushers{0};
+};
+
+
+template<typename T>
+Bounded_Queue<T>::Bounded_Queue(std::size_t capacity)
+:   mSlots(std::make_unique<Slot[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))),
+    mMask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+{
+    for(std::size_t i = 0; i <= mMask; ++i)
+    {
+        mSlots[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+Bounded_Queue<T>::~Bounded_Queue()
+{
+    const std::size_t end = mPush_pos.load(std::memory_order_relaxed);
+    for(std::size_t pos = mPop_pos.load(std::memory_order_relaxed); pos != end; ++pos)
+    {
+        mSlots[pos & mMask].element()->~T();
+    }
+}
+
+template<typename T> template<typename U>
+bool Bounded_Queue<T>::push(U &&IN_element, Backpressure policy)
+{
+    while(!try_push(std::forward<U>(IN_element)))
+    {
+        switch(policy)
+        {
+        case Backpressure::Fail:
+            return false;
+        case Backpressure::Drop_Oldest:
+        {
+            //Another consumer may have made room already, then there is nothing to drop
+            [[maybe_unused]] auto dropped = try_pop();
+            break;
+        }
+        case Backpressure::Block:
+        {
+            const std::uint32_t pops = mPop_count.load();
+            mBlocked_pushers.fetch_add(1);
+            //Pairs with the fence in try_pop(): either we see the freed slot, or the pop sees us and bumps mPop_count
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const bool pushed = try_push(std::forward<U>(IN_element));
+            if(!pushed)
+            {
+                mPop_count.wait(pops);
+            }
+            mBlocked_pushers.fetch_sub(1);
+            if(pushed)
+            {
+                return true;
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+template<typename T> template<typename U>
+bool Bounded_Queue<T>::try_push(U &&IN_element)
+{
+    std::size_t pos = mPush_pos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while(true)
+    {
+        slot = &mSlots[pos & mMask];
+        const std::size_t seq = slot->seq.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if(diff == 0)
+        {
+            if(mPush_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            return false; //Slot still holds the element from one lap ago
+        }
+        else
+        {
+            pos = mPush_pos.load(std::memory_order_relaxed);
+        }
+    }
+    ::new (static_cast<void*>(slot->storage)) T(std::forward<U>(IN_element));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+std::optional<T> Bounded_Queue<T>::try_pop(std::size_t *OUT_position)
+{
+    std::size_t pos = mPop_pos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while(true)
+    {
+        slot = &mSlots[pos & mMask];
+        const std::size_t seq = slot->seq.load(std::memory_order_acquire);
+        const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if(diff == 0)
+        {
+            if(mPop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            return std::nullopt;
+        }
+        else
+        {
+            pos = mPop_pos.load(std::memory_order_relaxed);
+        }
+    }
+    std::optional<T> result(std::move(*slot->element()));
+    slot->element()->~T();
+    slot->seq.store(pos + mMask + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(mBlocked_pushers.load(std::memory_order_relaxed) != 0)
+    {
+        mPop_count.fetch_add(1);
+        mPop_count.notify_all();
+    }
+    if(OUT_position)
+    {
+        *OUT_position = pos;
+    }
+    return result;
+}
+
+template<typename T>
+bool Bounded_Queue<T>::empty() const
+{
+    return mPop_pos.load() >= mPush_pos.load();
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // BOUNDED_QUEUE_H
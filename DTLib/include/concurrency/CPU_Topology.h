@@ -0,0 +1,66 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief NUMA nodes of the machine and the CPUs that belong to them.
+ * On Linux the topology is read from /sys/devices/system/node, machines without NUMA support
+ * (or other systems) are reported as a single node 0 containing every online CPU.
+ */
+class CPU_Topology
+{
+public:
+    struct Node
+    {
+        int id; //Kernel node number, not necessarily contiguous
+        std::vector<int> cpus; //Sorted, online CPUs only
+    };
+
+    //Topology of the running machine
+    [[nodiscard]] static CPU_Topology detect();
+
+    //Topology below a sysfs-like root, i.e. root/devices/system/{node,cpu}
+    [[nodiscard]] static CPU_Topology from_sysfs(const std::filesystem::path &root);
+
+    //Single node 0 with the given CPUs
+    [[nodiscard]] static CPU_Topology single_node(std::vector<int> cpus);
+
+    /*!
+     * \brief Parses a kernel CPU list like "0-3,8,10-11"
+     * \return Sorted CPU numbers. Throws OmegaException on malformed input
+     */
+    [[nodiscard]] static std::vector<int> parse_cpu_list(std::string_view cpu_list);
+
+    [[nodiscard]] const std::vector<Node>& nodes() const noexcept { return mNodes; }
+    [[nodiscard]] std::size_t cpu_count() const noexcept;
+
+    //Node the CPU belongs to, -1 if it is unknown
+    [[nodiscard]] int node_of_cpu(int cpu) const noexcept;
+
+private:
+    std::vector<Node> mNodes;
+};
+
+/*!
+ * \brief Restricts the calling thread to the given CPUs. An empty set allows every CPU.
+ * \return False if the system rejected the set or does not support affinity
+ */
+bool pin_current_thread(std::span<const int> cpus);
+
+//CPU the calling thread currently runs on, -1 if unknown
+[[nodiscard]] int current_cpu() noexcept;
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // CPU_TOPOLOGY_H
@@ -0,0 +1,110 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Histogram of durations with power-of-two buckets.
+ * Bucket 0 counts zero durations, bucket i counts durations in [2^(i-1), 2^i) ns, the last bucket everything above.
+ * record() is one relaxed atomic increment, snapshot() reads the buckets without locking,
+ * so a snapshot taken while recording may be off by the increments in flight.
+ */
+class Latency_Histogram
+{
+public:
+    static constexpr std::size_t NUM_BUCKETS = 48; //The last regular bucket ends at about 39 hours
+
+    struct Snapshot
+    {
+        std::array<std::uint64_t, NUM_BUCKETS> buckets{};
+
+        [[nodiscard]] std::uint64_t count() const noexcept
+        {
+            std::uint64_t total = 0;
+            for(std::uint64_t bucket : buckets)
+            {
+                total += bucket;
+            }
+            return total;
+        }
+
+        //Upper bound of the bucket that contains the given quantile (0..1), zero for an empty histogram
+        [[nodiscard]] std::chrono::nanoseconds quantile(double fraction) const noexcept
+        {
+            const std::uint64_t total = count();
+            if(total == 0)
+            {
+                return std::chrono::nanoseconds::zero();
+            }
+            const double clamped = fraction < 0.0 ? 0.0 : (fraction > 1.0 ? 1.0 : fraction);
+            const std::uint64_t rank = static_cast<std::uint64_t>(clamped * static_cast<double>(total - 1)) + 1;
+            std::uint64_t seen = 0;
+            for(std::size_t bucket_idx = 0; bucket_idx < NUM_BUCKETS; ++bucket_idx)
+            {
+                seen += buckets[bucket_idx];
+                if(seen >= rank)
+                {
+                    return bucket_upper_bound(bucket_idx);
+                }
+            }
+            return bucket_upper_bound(NUM_BUCKETS - 1);
+        }
+
+        Snapshot& operator+=(const Snapshot &rhs) noexcept
+        {
+            for(std::size_t bucket_idx = 0; bucket_idx < NUM_BUCKETS; ++bucket_idx)
+            {
+                buckets[bucket_idx] += rhs.buckets[bucket_idx];
+            }
+            return *this;
+        }
+    };
+
+    void record(std::chrono::nanoseconds duration) noexcept
+    {
+        mBuckets[bucket_index(duration)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Snapshot snapshot() const noexcept
+    {
+        Snapshot result;
+        for(std::size_t bucket_idx = 0; bucket_idx < NUM_BUCKETS; ++bucket_idx)
+        {
+            result.buckets[bucket_idx] = mBuckets[bucket_idx].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    [[nodiscard]] static std::size_t bucket_index(std::chrono::nanoseconds duration) noexcept
+    {
+        if(duration.count() <= 0)
+        {
+            return 0;
+        }
+        const std::size_t width = std::bit_width(static_cast<std::uint64_t>(duration.count()));
+        return width < NUM_BUCKETS ? width : NUM_BUCKETS - 1;
+    }
+
+    [[nodiscard]] static std::chrono::nanoseconds bucket_upper_bound(std::size_t bucket_idx) noexcept
+    {
+        return std::chrono::nanoseconds((std::int64_t{1} << bucket_idx) - 1);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, NUM_BUCKETS> mBuckets{};
+};
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // LATENCY_HISTOGRAM_H
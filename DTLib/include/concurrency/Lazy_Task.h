@@ -0,0 +1,239 @@
+#ifndef LAZY_TASK_H
+#define LAZY_TASK_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <utility>
+#include <DTools/concurrency/Result_Storage.h>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+template<typename T>
+class Lazy_Task;
+
+namespace NS_lazy_task_detail
+{
+
+//Resumes whoever awaited the finished coroutine (symmetric transfer, no stack growth)
+struct Final_Awaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+    {
+        if(std::coroutine_handle<> continuation = handle.promise().continuation)
+        {
+            return continuation;
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+template<typename T>
+class Promise_Base
+{
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    Final_Awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { result.set_exception(std::current_exception()); }
+
+    std::coroutine_handle<> continuation;
+    Result_Storage<T> result;
+};
+
+//Coroutine driven by sync_wait(); signals the waiting thread when it finishes
+class Sync_Wait_Task
+{
+public:
+    struct promise_type
+    {
+        Sync_Wait_Task get_return_object() { return Sync_Wait_Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        auto final_suspend() const noexcept
+        {
+            struct Notify_Awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+                {
+                    promise_type &promise = handle.promise();
+                    //Notify under the lock, the waiter destroys mutex and cv as soon as it sees done
+                    std::lock_guard<std::mutex> lk(*promise.done_mut);
+                    *promise.done = true;
+                    promise.done_cv->notify_all();
+                }
+                void await_resume() const noexcept {}
+            };
+            return Notify_Awaiter{};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+
+        std::mutex *done_mut{nullptr};
+        std::condition_variable *done_cv{nullptr};
+        bool *done{nullptr};
+    };
+
+    explicit Sync_Wait_Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    ~Sync_Wait_Task() { m_handle.destroy(); }
+
+    Sync_Wait_Task(const Sync_Wait_Task&) = delete;
+    Sync_Wait_Task& operator=(const Sync_Wait_Task&) = delete;
+    Sync_Wait_Task(Sync_Wait_Task&&) = delete;
+    Sync_Wait_Task& operator=(Sync_Wait_Task&&) = delete;
+
+    void run_and_wait()
+    {
+        std::mutex done_mut;
+        std::condition_variable done_cv;
+        bool done = false;
+        m_handle.promise().done_mut = &done_mut;
+        m_handle.promise().done_cv = &done_cv;
+        m_handle.promise().done = &done;
+
+        m_handle.resume();
+        std::unique_lock<std::mutex> lk(done_mut);
+        done_cv.wait(lk, [&done](){ return done; });
+    }
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template<typename T>
+Sync_Wait_Task make_sync_wait_task(Lazy_Task<T> &task, Result_Storage<T> &result)
+{
+    try
+    {
+        if constexpr(std::is_void_v<T>)
+        {
+            co_await task;
+            result.set_value();
+        }
+        else
+        {
+            result.set_value(co_await task);
+        }
+    }
+    catch(...)
+    {
+        result.set_exception(std::current_exception());
+    }
+}
+
+} //NS_lazy_task_detail
+
+
+/*!
+ * \brief Lazily started coroutine returning T.
+ * The body only starts running when the task is co_awaited and resumes the awaiting coroutine
+ * directly when it finishes (symmetric transfer), so chains of tasks neither block threads nor grow the stack.
+ * Combine with Thread_Pool::schedule() to move a coroutine onto the pool:
+ *
+ *     Lazy_Task<int> step(Thread_Pool &pool)
+ *     {
+ *         co_await pool.schedule(); //continues on a pool worker
+ *         co_return 42;
+ *     }
+ *
+ * Use sync_wait() to run a task from non-coroutine code.
+ */
+template<typename T>
+class [[nodiscard]] Lazy_Task
+{
+public:
+    struct promise_type : NS_lazy_task_detail::Promise_Base<T>
+    {
+        Lazy_Task get_return_object() { return Lazy_Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+        template<typename U>
+        void return_value(U &&value) { this->result.set_value(std::forward<U>(value)); }
+    };
+
+    Lazy_Task() = default;
+    ~Lazy_Task() { reset(); }
+
+    Lazy_Task(Lazy_Task &&rhs) noexcept : m_handle(std::exchange(rhs.m_handle, nullptr)) {}
+    Lazy_Task& operator=(Lazy_Task &&rhs) noexcept
+    {
+        if(this != &rhs)
+        {
+            reset();
+            m_handle = std::exchange(rhs.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Lazy_Task(const Lazy_Task&) = delete;
+    Lazy_Task& operator=(const Lazy_Task&) = delete;
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result.get(); }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    explicit Lazy_Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    void reset() noexcept
+    {
+        if(m_handle)
+        {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template<>
+struct Lazy_Task<void>::promise_type : NS_lazy_task_detail::Promise_Base<void>
+{
+    Lazy_Task get_return_object() { return Lazy_Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+    void return_void() noexcept {}
+};
+
+/*!
+ * \brief Runs task to completion and blocks the calling thread until it is done.
+ * The task starts on the calling thread and continues wherever it schedules itself.
+ * \return The result of the task. Rethrows an exception that escaped the task.
+ */
+template<typename T>
+T sync_wait(Lazy_Task<T> task)
+{
+    Result_Storage<T> result;
+    {
+        NS_lazy_task_detail::Sync_Wait_Task waiter = NS_lazy_task_detail::make_sync_wait_task(task, result);
+        waiter.run_and_wait();
+    }
+    return result.get();
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // LAZY_TASK_H
@@ -0,0 +1,418 @@
+#ifndef PARALLEL_ALGORITHMS_H
+#define PARALLEL_ALGORITHMS_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <vector>
+#include <DTools/concurrency/Thread_Pool.h>
+
+/*
+ * Fork/join algorithms on an explicit Thread_Pool.
+ * The calling thread works on the range together with up to thread_count() helper tasks and only waits
+ * for pieces other threads are still busy with, so the algorithms may also be called from within pool tasks.
+ * Pieces are claimed from a shared counter (guided self-scheduling): they start at 1/(2 * participants)
+ * of the remaining range and shrink towards the end, which balances uneven work with few claims.
+ * The first exception thrown by a functor is rethrown to the caller once all claimed pieces are done.
+ * Like their std counterparts with std::execution::par, the functors may be called concurrently.
+ */
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+namespace NS_parallel_detail
+{
+
+//Ranges below this many elements per participant are processed by the calling thread alone
+constexpr std::size_t MIN_ELEMENTS_PER_PARTICIPANT = 2048;
+//The smallest piece is 1/PIECES_PER_PARTICIPANT of an even share
+constexpr std::size_t PIECES_PER_PARTICIPANT = 32;
+
+[[nodiscard]] inline std::size_t participant_count(const Thread_Pool &pool, std::size_t size)
+{
+    const std::size_t max_participants = static_cast<std::size_t>(pool.thread_count()) + 1;
+    return std::clamp<std::size_t>(size / MIN_ELEMENTS_PER_PARTICIPANT, 1, max_participants);
+}
+
+template<typename Body>
+class Fork_Join_State
+{
+public:
+    Fork_Join_State(std::size_t size, std::size_t min_piece, std::size_t participants, bool guided, Body &body)
+        : m_size(size), m_min_piece(min_piece), m_participants(participants), m_guided(guided), m_body(body) {}
+
+    //Claims and processes pieces until the range is exhausted
+    void participate() noexcept
+    {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        while(claim(begin, end))
+        {
+            if(!m_failed.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    m_body(begin, end);
+                }
+                catch(...)
+                {
+                    if(!m_failed.exchange(true))
+                    {
+                        m_error = std::current_exception();
+                    }
+                }
+            }
+            if(m_completed.fetch_add(end - begin, std::memory_order_acq_rel) + (end - begin) == m_size)
+            {
+                m_completed.notify_all();
+            }
+        }
+    }
+
+    //Blocks until every piece is processed, rethrows the first exception
+    void wait()
+    {
+        std::size_t completed = m_completed.load(std::memory_order_acquire);
+        while(completed != m_size)
+        {
+            m_completed.wait(completed, std::memory_order_acquire);
+            completed = m_completed.load(std::memory_order_acquire);
+        }
+        if(m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+private:
+    bool claim(std::size_t &OUT_begin, std::size_t &OUT_end) noexcept
+    {
+        std::size_t begin = m_next.load(std::memory_order_relaxed);
+        while(begin < m_size)
+        {
+            const std::size_t remaining = m_size - begin;
+            const std::size_t piece = std::min(remaining, m_guided ? std::max(m_min_piece, remaining / (2 * m_participants)) : m_min_piece);
+            if(m_next.compare_exchange_weak(begin, begin + piece, std::memory_order_relaxed))
+            {
+                OUT_begin = begin;
+                OUT_end = begin + piece;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::size_t m_size;
+    const std::size_t m_min_piece;
+    const std::size_t m_participants;
+    const bool m_guided;
+    Body &m_body; //Only called for claimed pieces, all of which finish before the caller returns
+    std::atomic<std::size_t> m_next{0};
+    std::atomic<std::size_t> m_completed{0};
+    std::atomic<bool> m_failed{false};
+    std::exception_ptr m_error; //Written once before m_completed reaches m_size
+};
+
+/*!
+ * \brief Calls body(begin, end) for pieces covering [0, size) on the pool and the calling thread.
+ * \param guided: Adaptive piece sizes if true, pieces of exactly min_piece (the last one may be shorter) otherwise
+ */
+template<typename Body>
+void fork_join(Thread_Pool &pool, std::size_t size, std::size_t participants, std::size_t min_piece, bool guided, Body &&body)
+{
+    if(size == 0)
+    {
+        return;
+    }
+    if(participants <= 1)
+    {
+        body(std::size_t{0}, size);
+        return;
+    }
+
+    //Helpers that start late find nothing to claim, but may still touch the state after the caller returned
+    auto state = std::make_shared<Fork_Join_State<std::remove_reference_t<Body>>>(size, min_piece, participants, guided, body);
+    for(std::size_t helper_idx = 0; helper_idx + 1 < participants; ++helper_idx)
+    {
+        pool.post_free([state](){ state->participate(); });
+    }
+    state->participate();
+    state->wait();
+}
+
+//Adaptive pieces over [0, size), the size of the smallest one scales with the range
+template<typename Body>
+void guided_for(Thread_Pool &pool, std::size_t size, Body &&body)
+{
+    const std::size_t participants = participant_count(pool, size);
+    const std::size_t min_piece = std::max<std::size_t>(1, size / (participants * PIECES_PER_PARTICIPANT));
+    fork_join(pool, size, participants, min_piece, true, std::forward<Body>(body));
+}
+
+//Calls body(chunk_idx) for every chunk_idx in [0, num_chunks), one chunk per claim
+template<typename Body>
+void for_each_chunk(Thread_Pool &pool, std::size_t num_chunks, std::size_t participants, Body &&body)
+{
+    fork_join(pool, num_chunks, std::min(participants, num_chunks), 1, false, [&body](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t chunk_idx = begin; chunk_idx < end; ++chunk_idx)
+        {
+            body(chunk_idx);
+        }
+    });
+}
+
+//Start of the chunk_idx-th of num_chunks nearly equal chunks of [0, size)
+[[nodiscard]] inline std::size_t chunk_begin(std::size_t size, std::size_t num_chunks, std::size_t chunk_idx)
+{
+    return size / num_chunks * chunk_idx + std::min(chunk_idx, size % num_chunks);
+}
+
+//Number of elements of a in the first out_idx elements of the stable merge of a and b
+template<typename It_a, typename It_b, typename Compare>
+[[nodiscard]] std::size_t merge_co_rank(std::size_t out_idx, It_a a, std::size_t a_size, It_b b, std::size_t b_size, Compare &comp)
+{
+    std::size_t low = out_idx > b_size ? out_idx - b_size : 0;
+    std::size_t high = std::min(out_idx, a_size);
+    while(low < high)
+    {
+        //Take a_take elements of a and out_idx - a_take of b. Too few from a if a[a_take] must precede b[b_take - 1]
+        const std::size_t a_take = low + (high - low) / 2;
+        const std::size_t b_take = out_idx - a_take;
+        if(b_take > 0 && a_take < a_size && !comp(b[b_take - 1], a[a_take]))
+        {
+            low = a_take + 1;
+        }
+        else
+        {
+            high = a_take;
+        }
+    }
+    return low;
+}
+
+//Merges the sorted runs [run_idx * run_size, ...) of src pairwise into dst, every merge split into pieces
+template<typename Src_it, typename Dst_it, typename Compare>
+void merge_runs(Thread_Pool &pool, Src_it src, Dst_it dst, std::size_t size, std::size_t run_size,
+                std::size_t participants, Compare &comp)
+{
+    const std::size_t num_merges = (size + 2 * run_size - 1) / (2 * run_size);
+    const std::size_t pieces_per_merge = std::max<std::size_t>(1, participants * 4 / num_merges);
+    const auto merge_bounds = [&](std::size_t merge_idx, std::size_t &OUT_a_begin, std::size_t &OUT_a_size, std::size_t &OUT_b_size)
+    {
+        OUT_a_begin = merge_idx * 2 * run_size;
+        OUT_a_size = std::min(run_size, size - OUT_a_begin);
+        OUT_b_size = std::min(run_size, size - OUT_a_begin - OUT_a_size);
+    };
+
+    //The pieces move their elements out of src, so all co-ranks are found before the first piece starts.
+    //a_splits[merge_idx * (pieces_per_merge + 1) + piece_idx] is the first element of a that piece takes
+    std::vector<std::size_t> a_splits(num_merges * (pieces_per_merge + 1));
+    for(std::size_t merge_idx = 0; merge_idx < num_merges; ++merge_idx)
+    {
+        std::size_t a_begin, a_size, b_size;
+        merge_bounds(merge_idx, a_begin, a_size, b_size);
+        const Src_it a = src + a_begin;
+        for(std::size_t piece_idx = 0; piece_idx <= pieces_per_merge; ++piece_idx)
+        {
+            const std::size_t out_idx = chunk_begin(a_size + b_size, pieces_per_merge, piece_idx);
+            a_splits[merge_idx * (pieces_per_merge + 1) + piece_idx] = merge_co_rank(out_idx, a, a_size, a + a_size, b_size, comp);
+        }
+    }
+
+    for_each_chunk(pool, num_merges * pieces_per_merge, participants, [&](std::size_t chunk_idx)
+    {
+        const std::size_t merge_idx = chunk_idx / pieces_per_merge;
+        const std::size_t piece_idx = chunk_idx % pieces_per_merge;
+        std::size_t a_begin, a_size, b_size;
+        merge_bounds(merge_idx, a_begin, a_size, b_size);
+
+        const std::size_t out_begin = chunk_begin(a_size + b_size, pieces_per_merge, piece_idx);
+        const std::size_t out_end = chunk_begin(a_size + b_size, pieces_per_merge, piece_idx + 1);
+        const std::size_t a_first = a_splits[merge_idx * (pieces_per_merge + 1) + piece_idx];
+        const std::size_t a_last = a_splits[merge_idx * (pieces_per_merge + 1) + piece_idx + 1];
+        const Src_it a = src + a_begin;
+        const Src_it b = a + a_size;
+        std::merge(std::make_move_iterator(a + a_first), std::make_move_iterator(a + a_last),
+                   std::make_move_iterator(b + (out_begin - a_first)), std::make_move_iterator(b + (out_end - a_last)),
+                   dst + (a_begin + out_begin), comp);
+    });
+}
+
+} //NS_parallel_detail
+
+
+/*!
+ * \brief Calls f(element) for every element of [first, last)
+ */
+template<std::random_access_iterator It, typename Functor>
+void parallel_for_each(Thread_Pool &pool, It first, It last, Functor f)
+{
+    NS_parallel_detail::guided_for(pool, static_cast<std::size_t>(last - first), [first, &f](std::size_t begin, std::size_t end)
+    {
+        std::for_each(first + begin, first + end, std::ref(f));
+    });
+}
+
+/*!
+ * \brief Writes f(element) for every element of [first, last) to the range starting at d_first
+ * \return Iterator past the last written element
+ */
+template<std::random_access_iterator It, std::random_access_iterator Out_it, typename Functor>
+Out_it parallel_transform(Thread_Pool &pool, It first, It last, Out_it d_first, Functor f)
+{
+    const std::size_t size = static_cast<std::size_t>(last - first);
+    NS_parallel_detail::guided_for(pool, size, [first, d_first, &f](std::size_t begin, std::size_t end)
+    {
+        std::transform(first + begin, first + end, d_first + begin, std::ref(f));
+    });
+    return d_first + size;
+}
+
+/*!
+ * \brief Combines init and all elements of [first, last) with op.
+ * Like std::reduce, op must be associative and commutative, the grouping of the elements is unspecified.
+ */
+template<std::random_access_iterator It, typename T, typename Binary_op = std::plus<>>
+T parallel_reduce(Thread_Pool &pool, It first, It last, T init, Binary_op op = {})
+{
+    std::mutex result_mut;
+    std::optional<T> result;
+    NS_parallel_detail::guided_for(pool, static_cast<std::size_t>(last - first), [&](std::size_t begin, std::size_t end)
+    {
+        T partial = *(first + begin);
+        for(It it = first + begin + 1; it != first + end; ++it)
+        {
+            partial = op(std::move(partial), *it);
+        }
+
+        std::lock_guard<std::mutex> lk(result_mut);
+        result = result ? op(std::move(*result), std::move(partial)) : std::move(partial);
+    });
+    return result ? op(std::move(init), std::move(*result)) : init;
+}
+
+/*!
+ * \brief Inclusive prefix scan of [first, last) with op into the range starting at d_first, like std::inclusive_scan.
+ * op must be associative. Two passes: the chunk totals are reduced in parallel, then every chunk is scanned
+ * starting from the combined totals of the chunks before it. d_first may be first.
+ * \return Iterator past the last written element
+ */
+template<std::random_access_iterator It, std::random_access_iterator Out_it, typename Binary_op = std::plus<>>
+Out_it parallel_scan(Thread_Pool &pool, It first, It last, Out_it d_first, Binary_op op = {})
+{
+    using value_t = std::iter_value_t<It>;
+    const std::size_t size = static_cast<std::size_t>(last - first);
+    const std::size_t participants = NS_parallel_detail::participant_count(pool, size);
+    if(participants <= 1)
+    {
+        return std::inclusive_scan(first, last, d_first, op);
+    }
+
+    //Fixed chunks, the second pass needs the same boundaries as the first
+    const std::size_t num_chunks = participants * 4;
+    std::vector<std::optional<value_t>> chunk_totals(num_chunks);
+    NS_parallel_detail::for_each_chunk(pool, num_chunks, participants, [&](std::size_t chunk_idx)
+    {
+        const std::size_t begin = NS_parallel_detail::chunk_begin(size, num_chunks, chunk_idx);
+        const std::size_t end = NS_parallel_detail::chunk_begin(size, num_chunks, chunk_idx + 1);
+        value_t total = *(first + begin);
+        for(It it = first + begin + 1; it != first + end; ++it)
+        {
+            total = op(std::move(total), *it);
+        }
+        chunk_totals[chunk_idx] = std::move(total);
+    });
+
+    //Turn the totals into the carry of each chunk: everything before it
+    std::optional<value_t> carry;
+    for(std::optional<value_t> &chunk_total : chunk_totals)
+    {
+        std::optional<value_t> next_carry = carry ? op(*carry, *chunk_total) : std::move(*chunk_total);
+        chunk_total = std::move(carry);
+        carry = std::move(next_carry);
+    }
+
+    NS_parallel_detail::for_each_chunk(pool, num_chunks, participants, [&](std::size_t chunk_idx)
+    {
+        const std::size_t begin = NS_parallel_detail::chunk_begin(size, num_chunks, chunk_idx);
+        const std::size_t end = NS_parallel_detail::chunk_begin(size, num_chunks, chunk_idx + 1);
+        if(chunk_totals[chunk_idx])
+        {
+            std::inclusive_scan(first + begin, first + end, d_first + begin, op, *chunk_totals[chunk_idx]);
+        }
+        else
+        {
+            std::inclusive_scan(first + begin, first + end, d_first + begin, op);
+        }
+    });
+    return d_first + size;
+}
+
+/*!
+ * \brief Sorts [first, last) with comp. Not stable.
+ * The range is split into one run per participant (rounded up to a power of two) that are sorted in parallel,
+ * then the runs are merged pairwise into a buffer and back. Every merge is split into pieces at co-ranks
+ * found by binary search, so all participants stay busy down to the last merge.
+ * Needs a buffer of last - first elements.
+ */
+template<std::random_access_iterator It, typename Compare = std::less<>>
+void parallel_sort(Thread_Pool &pool, It first, It last, Compare comp = {})
+{
+    using value_t = std::iter_value_t<It>;
+    const std::size_t size = static_cast<std::size_t>(last - first);
+    const std::size_t participants = NS_parallel_detail::participant_count(pool, size);
+    if(participants <= 1)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    const std::size_t num_runs = std::bit_ceil(participants);
+    const std::size_t run_size = (size + num_runs - 1) / num_runs;
+    NS_parallel_detail::for_each_chunk(pool, num_runs, participants, [&](std::size_t run_idx)
+    {
+        const std::size_t begin = std::min(size, run_idx * run_size);
+        const std::size_t end = std::min(size, begin + run_size);
+        std::sort(first + begin, first + end, comp);
+    });
+
+    //The sorted runs move into the buffer, from there the merge levels alternate between buffer and range
+    std::vector<value_t> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    bool result_in_buffer = true;
+    for(std::size_t curr_run_size = run_size; curr_run_size < size; curr_run_size *= 2)
+    {
+        if(result_in_buffer)
+        {
+            NS_parallel_detail::merge_runs(pool, buffer.begin(), first, size, curr_run_size, participants, comp);
+        }
+        else
+        {
+            NS_parallel_detail::merge_runs(pool, first, buffer.begin(), size, curr_run_size, participants, comp);
+        }
+        result_in_buffer = !result_in_buffer;
+    }
+
+    if(result_in_buffer)
+    {
+        NS_parallel_detail::guided_for(pool, size, [&](std::size_t begin, std::size_t end)
+        {
+            std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+        });
+    }
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // PARALLEL_ALGORITHMS_H
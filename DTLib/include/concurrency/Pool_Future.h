@@ -0,0 +1,555 @@
+#ifndef POOL_FUTURE_H
+#define POOL_FUTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <variant>
+#include <vector>
+#include <DTools/MiscTools.h>
+#include <DTools/concurrency/Result_Storage.h>
+#include <DTools/concurrency/Thread_Pool.h>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+template<typename T>
+class Pool_Future;
+
+template<typename T>
+class Pool_Promise;
+
+//Result of when_any(): index of the first finished input and its value
+template<typename T>
+struct When_Any_Result
+{
+    std::size_t index;
+    T value;
+};
+
+namespace NS_pool_future_detail
+{
+
+//State shared by a Pool_Promise and its Pool_Future. Holds at most one continuation,
+//which is posted to the pool as soon as the result is published
+template<typename T>
+class Shared_State
+{
+public:
+    explicit Shared_State(Thread_Pool &pool) : m_pool(pool) {}
+
+    Shared_State(const Shared_State &rhs) = delete;
+    Shared_State& operator=(const Shared_State &rhs) = delete;
+
+    [[nodiscard]] Thread_Pool& pool() const noexcept { return m_pool; }
+
+    template<typename... U>
+    void set_value(U&&... value)
+    {
+        publish([&](){ m_result.set_value(std::forward<U>(value)...); });
+    }
+
+    void set_exception(std::exception_ptr error)
+    {
+        publish([&](){ m_result.set_exception(std::move(error)); });
+    }
+
+    [[nodiscard]] bool is_ready() const
+    {
+        std::lock_guard<std::mutex> lk(m_mut);
+        return m_ready;
+    }
+
+    void wait() const
+    {
+        std::unique_lock<std::mutex> lk(m_mut);
+        m_cv.wait(lk, [this](){ return m_ready; });
+    }
+
+    //Only valid once the state is ready
+    [[nodiscard]] Result_Storage<T>& result() noexcept { return m_result; }
+
+    //Posts continuation right away if the result is already there
+    void set_continuation(Pool_Task &&continuation, int priority)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_mut);
+            if(!m_ready)
+            {
+                m_continuation = std::move(continuation);
+                m_continuation_priority = priority;
+                return;
+            }
+        }
+        m_pool.post_task(std::move(continuation), priority);
+    }
+
+private:
+    template<typename Setter>
+    void publish(Setter &&setter)
+    {
+        Pool_Task continuation;
+        {
+            std::lock_guard<std::mutex> lk(m_mut);
+            if(m_ready)
+            {
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            }
+            setter();
+            m_ready = true;
+            continuation = std::move(m_continuation);
+            m_cv.notify_all();
+        }
+        if(continuation)
+        {
+            m_pool.post_task(std::move(continuation), m_continuation_priority);
+        }
+    }
+
+    Thread_Pool &m_pool;
+    mutable std::mutex m_mut;
+    mutable std::condition_variable m_cv;
+    bool m_ready{false};
+    Result_Storage<T> m_result;
+    Pool_Task m_continuation;
+    int m_continuation_priority{NS_priority_mutex::DEFAULT_PRIORITY};
+};
+
+template<typename Functor, typename T>
+struct Continuation_Result
+{
+    using type = std::invoke_result_t<Functor, T>;
+};
+
+template<typename Functor>
+struct Continuation_Result<Functor, void>
+{
+    using type = std::invoke_result_t<Functor>;
+};
+
+template<typename Functor, typename T>
+using continuation_result_t = typename Continuation_Result<std::decay_t<Functor>, T>::type;
+
+//Invokes f and stores its result or exception in promise
+template<typename result_t, typename Functor, typename... argtypes>
+void fulfill(Pool_Promise<result_t> &promise, Functor&& f, argtypes&&... args) noexcept
+{
+    try
+    {
+        if constexpr(std::is_void_v<result_t>)
+        {
+            std::invoke(std::forward<Functor>(f), std::forward<argtypes>(args)...);
+            promise.set_value();
+        }
+        else
+        {
+            promise.set_value(std::invoke(std::forward<Functor>(f), std::forward<argtypes>(args)...));
+        }
+    }
+    catch(...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+struct Combinators;
+
+} //NS_pool_future_detail
+
+
+/*!
+ * \brief Future whose continuations run on a Thread_Pool instead of blocking a thread.
+ * then() registers a continuation that is posted to the pool as soon as the result is available,
+ * so dependent tasks can be chained without any thread waiting in get().
+ * Exceptions skip the continuations and propagate to the end of the chain.
+ * Like std::future, get() and then() consume the future. The destructor never blocks.
+ */
+template<typename T>
+class [[nodiscard]] Pool_Future
+{
+public:
+    Pool_Future() = default;
+
+    Pool_Future(Pool_Future &&rhs) noexcept = default;
+    Pool_Future& operator=(Pool_Future &&rhs) noexcept = default;
+    Pool_Future(const Pool_Future &rhs) = delete;
+    Pool_Future& operator=(const Pool_Future &rhs) = delete;
+
+    [[nodiscard]] bool valid() const noexcept { return m_state != nullptr; }
+    [[nodiscard]] bool is_ready() const { return state().is_ready(); }
+    void wait() const { state().wait(); }
+
+/*!
+ * \brief Blocks until the result is available and consumes the future
+ * \return The value. Rethrows the exception stored in the future.
+ */
+T get()
+{
+    std::shared_ptr<NS_pool_future_detail::Shared_State<T>> curr_state = take_state();
+    curr_state->wait();
+    return curr_state->result().get();
+}
+
+/*!
+ * \brief Post f to the pool once the result is available. Consumes the future.
+ * \param f: Continuation, called with the value (nothing for void). Not called if the future holds an exception.
+ * \return Future for the result of f
+ */
+template<typename Functor>
+[[nodiscard]] Pool_Future<NS_pool_future_detail::continuation_result_t<Functor, T>> then(Functor&& f)
+{
+    return then(NS_priority_mutex::DEFAULT_PRIORITY, std::forward<Functor>(f));
+}
+
+/*!
+ * \brief Post f with the given priority to the pool once the result is available. Consumes the future.
+ * \param priority: Higher values are executed first
+ * \param f: Continuation, called with the value (nothing for void). Not called if the future holds an exception.
+ * \return Future for the result of f
+ */
+template<typename Functor>
+[[nodiscard]] Pool_Future<NS_pool_future_detail::continuation_result_t<Functor, T>> then(int priority, Functor&& f)
+{
+    using result_t = NS_pool_future_detail::continuation_result_t<Functor, T>;
+    Pool_Promise<result_t> promise(state().pool());
+    Pool_Future<result_t> future = promise.get_future();
+    on_ready([promise=std::move(promise), f=std::forward<Functor>(f)](Result_Storage<T> &input) mutable
+    {
+        if(input.has_exception())
+        {
+            promise.set_exception(input.exception());
+        }
+        else if constexpr(std::is_void_v<T>)
+        {
+            NS_pool_future_detail::fulfill(promise, std::move(f));
+        }
+        else
+        {
+            NS_pool_future_detail::fulfill(promise, std::move(f), input.get());
+        }
+    }, priority);
+    return future;
+}
+
+private:
+    friend class Pool_Promise<T>;
+    friend struct NS_pool_future_detail::Combinators;
+
+    explicit Pool_Future(std::shared_ptr<NS_pool_future_detail::Shared_State<T>> state) : m_state(std::move(state)) {}
+
+    NS_pool_future_detail::Shared_State<T>& state() const
+    {
+        if(!m_state)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return *m_state;
+    }
+
+    std::shared_ptr<NS_pool_future_detail::Shared_State<T>> take_state()
+    {
+        state();
+        return std::move(m_state);
+    }
+
+    //Posts f(Result_Storage<T>&) to the pool once the result is available. Consumes the future
+    template<typename Functor>
+    void on_ready(Functor&& f, int priority)
+    {
+        std::shared_ptr<NS_pool_future_detail::Shared_State<T>> curr_state = take_state();
+        NS_pool_future_detail::Shared_State<T> &state_ref = *curr_state;
+        //The continuation keeps the state alive until it ran
+        state_ref.set_continuation([curr_state=std::move(curr_state), f=std::forward<Functor>(f)]() mutable
+        {
+            std::invoke(std::move(f), curr_state->result());
+        }, priority);
+    }
+
+    std::shared_ptr<NS_pool_future_detail::Shared_State<T>> m_state;
+};
+
+/*!
+ * \brief Producer side of a Pool_Future.
+ * Continuations of the future are posted to the given pool.
+ * Destroying the promise without setting a result stores a std::future_error(broken_promise).
+ */
+template<typename T>
+class Pool_Promise
+{
+public:
+    explicit Pool_Promise(Thread_Pool &pool) : m_state(std::make_shared<NS_pool_future_detail::Shared_State<T>>(pool)) {}
+    ~Pool_Promise()
+    {
+        if(m_state && !m_state->is_ready())
+        {
+            m_state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    Pool_Promise(Pool_Promise &&rhs) noexcept = default;
+    Pool_Promise& operator=(Pool_Promise &&rhs) = delete;
+    Pool_Promise(const Pool_Promise &rhs) = delete;
+    Pool_Promise& operator=(const Pool_Promise &rhs) = delete;
+
+    [[nodiscard]] Pool_Future<T> get_future()
+    {
+        if(m_future_retrieved)
+        {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        m_future_retrieved = true;
+        return Pool_Future<T>(state_ptr());
+    }
+
+    template<typename... U>
+    void set_value(U&&... value)
+    {
+        state_ptr()->set_value(std::forward<U>(value)...);
+    }
+
+    void set_exception(std::exception_ptr error)
+    {
+        state_ptr()->set_exception(std::move(error));
+    }
+
+private:
+    const std::shared_ptr<NS_pool_future_detail::Shared_State<T>>& state_ptr() const
+    {
+        if(!m_state)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return m_state;
+    }
+
+    std::shared_ptr<NS_pool_future_detail::Shared_State<T>> m_state;
+    bool m_future_retrieved{false};
+};
+
+
+namespace NS_pool_future_detail
+{
+
+struct Combinators
+{
+    template<typename T>
+    using when_all_result_t = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+    template<typename T>
+    using when_any_result_t = std::conditional_t<std::is_void_v<T>, std::size_t, When_Any_Result<T>>;
+
+    template<typename T>
+    static Pool_Future<when_all_result_t<T>> when_all(std::vector<Pool_Future<T>> &&futures)
+    {
+        using result_t = when_all_result_t<T>;
+        using slot_t = std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>>;
+        struct Aggregate
+        {
+            Aggregate(Thread_Pool &pool, std::size_t num_inputs) : promise(pool), remaining(num_inputs), values(num_inputs) {}
+            Pool_Promise<result_t> promise;
+            std::atomic<std::size_t> remaining;
+            std::atomic_bool failed{false};
+            std::vector<slot_t> values; //Every slot is written by exactly one continuation
+        };
+
+        if(futures.empty())
+        {
+            throw NS_dtools::NS_misc::BaseOmegaException("when_all: no futures given");
+        }
+
+        auto aggregate = std::make_shared<Aggregate>(futures.front().state().pool(), futures.size());
+        Pool_Future<result_t> result = aggregate->promise.get_future();
+        for(std::size_t idx = 0; idx < futures.size(); ++idx)
+        {
+            futures[idx].on_ready([aggregate, idx](Result_Storage<T> &input)
+            {
+                if(input.has_exception())
+                {
+                    if(!aggregate->failed.exchange(true))
+                    {
+                        aggregate->promise.set_exception(input.exception());
+                    }
+                }
+                else if constexpr(!std::is_void_v<T>)
+                {
+                    aggregate->values[idx] = input.get();
+                }
+
+                if(aggregate->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !aggregate->failed.load())
+                {
+                    if constexpr(std::is_void_v<T>)
+                    {
+                        aggregate->promise.set_value();
+                    }
+                    else
+                    {
+                        std::vector<T> values;
+                        values.reserve(aggregate->values.size());
+                        for(std::optional<T> &value : aggregate->values)
+                        {
+                            values.push_back(std::move(*value));
+                        }
+                        aggregate->promise.set_value(std::move(values));
+                    }
+                }
+            }, NS_priority_mutex::DEFAULT_PRIORITY);
+        }
+        return result;
+    }
+
+    template<typename... Ts>
+    static Pool_Future<std::tuple<Ts...>> when_all(Pool_Future<Ts>&... futures)
+    {
+        struct Aggregate
+        {
+            explicit Aggregate(Thread_Pool &pool) : promise(pool) {}
+            Pool_Promise<std::tuple<Ts...>> promise;
+            std::atomic<std::size_t> remaining{sizeof...(Ts)};
+            std::atomic_bool failed{false};
+            std::tuple<std::optional<Ts>...> values;
+        };
+
+        auto aggregate = std::make_shared<Aggregate>(std::get<0>(std::tie(futures...)).state().pool());
+        Pool_Future<std::tuple<Ts...>> result = aggregate->promise.get_future();
+        auto attach = [&aggregate]<std::size_t idx, typename T>(std::integral_constant<std::size_t, idx>, Pool_Future<T> &future)
+        {
+            future.on_ready([aggregate](Result_Storage<T> &input)
+            {
+                if(input.has_exception())
+                {
+                    if(!aggregate->failed.exchange(true))
+                    {
+                        aggregate->promise.set_exception(input.exception());
+                    }
+                }
+                else
+                {
+                    std::get<idx>(aggregate->values) = input.get();
+                }
+
+                if(aggregate->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !aggregate->failed.load())
+                {
+                    aggregate->promise.set_value(std::apply([](std::optional<Ts>&... values)
+                    {
+                        return std::tuple<Ts...>(std::move(*values)...);
+                    }, aggregate->values));
+                }
+            }, NS_priority_mutex::DEFAULT_PRIORITY);
+        };
+        [&]<std::size_t... idx>(std::index_sequence<idx...>)
+        {
+            (attach(std::integral_constant<std::size_t, idx>{}, futures), ...);
+        }(std::index_sequence_for<Ts...>{});
+        return result;
+    }
+
+    template<typename T>
+    static Pool_Future<when_any_result_t<T>> when_any(std::vector<Pool_Future<T>> &&futures)
+    {
+        using result_t = when_any_result_t<T>;
+        struct Aggregate
+        {
+            explicit Aggregate(Thread_Pool &pool) : promise(pool) {}
+            Pool_Promise<result_t> promise;
+            std::atomic_bool done{false};
+        };
+
+        if(futures.empty())
+        {
+            throw NS_dtools::NS_misc::BaseOmegaException("when_any: no futures given");
+        }
+
+        auto aggregate = std::make_shared<Aggregate>(futures.front().state().pool());
+        Pool_Future<result_t> result = aggregate->promise.get_future();
+        for(std::size_t idx = 0; idx < futures.size(); ++idx)
+        {
+            futures[idx].on_ready([aggregate, idx](Result_Storage<T> &input)
+            {
+                if(aggregate->done.exchange(true))
+                {
+                    return;
+                }
+                if(input.has_exception())
+                {
+                    aggregate->promise.set_exception(input.exception());
+                }
+                else if constexpr(std::is_void_v<T>)
+                {
+                    aggregate->promise.set_value(idx);
+                }
+                else
+                {
+                    aggregate->promise.set_value(When_Any_Result<T>{idx, input.get()});
+                }
+            }, NS_priority_mutex::DEFAULT_PRIORITY);
+        }
+        return result;
+    }
+};
+
+} //NS_pool_future_detail
+
+
+/*!
+ * \brief Post a functor to the pool and get a Pool_Future for its result
+ * \param pool: Pool executing f and the continuations of the returned future
+ * \param f: Functor
+ * \param args: Functor arguments
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+[[nodiscard]] Pool_Future< task_result_t<Functor, argtypes...> > post_async(Thread_Pool &pool, Functor&& f, argtypes&&... args)
+{
+    Pool_Promise< task_result_t<Functor, argtypes...> > promise(pool);
+    Pool_Future< task_result_t<Functor, argtypes...> > future = promise.get_future();
+    pool.post_free([promise=std::move(promise), f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+    {
+        NS_pool_future_detail::fulfill(promise, std::move(f), std::move(args)...);
+    });
+    return future;
+}
+
+/*!
+ * \brief Future that becomes ready once all inputs are ready. Consumes the inputs.
+ * Fails with the first exception of any input, without waiting for the remaining ones.
+ * \return The values in input order, or a Pool_Future<void> for void inputs. Throws for an empty vector.
+ */
+template<typename T>
+[[nodiscard]] auto when_all(std::vector<Pool_Future<T>> futures)
+{
+    return NS_pool_future_detail::Combinators::when_all(std::move(futures));
+}
+
+/*!
+ * \brief Future that becomes ready once all inputs are ready. Consumes the inputs.
+ * Fails with the first exception of any input, without waiting for the remaining ones.
+ * \return Tuple with the values of all inputs
+ */
+template<typename... Ts>
+    requires (sizeof...(Ts) > 0 && (!std::is_void_v<Ts> && ...))
+[[nodiscard]] Pool_Future<std::tuple<Ts...>> when_all(Pool_Future<Ts>&&... futures)
+{
+    return NS_pool_future_detail::Combinators::when_all(futures...);
+}
+
+/*!
+ * \brief Future that becomes ready with the first input that is ready, value or exception. Consumes the inputs.
+ * \return Index and value of the first input, or only the index for void inputs. Throws for an empty vector.
+ */
+template<typename T>
+[[nodiscard]] auto when_any(std::vector<Pool_Future<T>> futures)
+{
+    return NS_pool_future_detail::Combinators::when_any(std::move(futures));
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // POOL_FUTURE_H
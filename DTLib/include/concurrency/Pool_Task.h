@@ -0,0 +1,171 @@
+#ifndef POOL_TASK_H
+#define POOL_TASK_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#ifdef DT_POOL_METRICS
+#include <chrono>
+#endif
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Move-only, type-erased void() callable with a small inline buffer.
+ * Callables of up to INLINE_CAPACITY bytes that are nothrow move constructible are stored inside the task itself,
+ * so creating, queueing and running them does not allocate. Larger callables are stored on the heap.
+ * Unlike std::function, the stored callable does not have to be copyable.
+ * With DT_POOL_METRICS the task also carries the time it was queued.
+ */
+class Pool_Task
+{
+public:
+    static constexpr std::size_t INLINE_CAPACITY = 64;
+
+    Pool_Task() noexcept = default;
+    Pool_Task(std::nullptr_t) noexcept {}
+
+    template<typename Functor>
+        requires (!std::is_same_v<std::remove_cvref_t<Functor>, Pool_Task>
+                  && std::is_invocable_v<std::decay_t<Functor>&>)
+    Pool_Task(Functor &&f);
+
+    ~Pool_Task() { reset(); }
+
+    Pool_Task(Pool_Task &&rhs) noexcept { take_from(rhs); }
+    Pool_Task& operator=(Pool_Task &&rhs) noexcept;
+    Pool_Task& operator=(std::nullptr_t) noexcept { reset(); return *this; }
+
+    Pool_Task(const Pool_Task&) = delete;
+    Pool_Task& operator=(const Pool_Task&) = delete;
+
+    void operator()() { m_vtable->invoke(m_storage); }
+
+    explicit operator bool() const noexcept { return m_vtable != nullptr; }
+
+    //Does the stored callable live in the inline buffer (no allocation)?
+    [[nodiscard]] bool is_inline() const noexcept { return m_vtable != nullptr && m_vtable->is_inline; }
+
+#ifdef DT_POOL_METRICS
+    void set_enqueue_time(std::chrono::steady_clock::time_point time) noexcept { m_enqueue_time = time; }
+    [[nodiscard]] std::chrono::steady_clock::time_point enqueue_time() const noexcept { return m_enqueue_time; }
+#endif
+
+private:
+    struct VTable
+    {
+        void (*invoke)(void *storage);
+        void (*relocate)(void *dst_storage, void *src_storage) noexcept; //move into dst and destroy src
+        void (*destroy)(void *storage) noexcept;
+        bool is_inline;
+    };
+
+    template<typename F>
+    static constexpr bool fits_inline()
+    {
+        return sizeof(F) <= INLINE_CAPACITY
+               && alignof(F) <= alignof(std::max_align_t)
+               && std::is_nothrow_move_constructible_v<F>;
+    }
+
+    template<typename F>
+    struct Inline_Ops
+    {
+        static void invoke(void *storage) { std::invoke(*std::launder(static_cast<F*>(storage))); }
+        static void relocate(void *dst_storage, void *src_storage) noexcept
+        {
+            F *src = std::launder(static_cast<F*>(src_storage));
+            ::new (dst_storage) F(std::move(*src));
+            src->~F();
+        }
+        static void destroy(void *storage) noexcept { std::launder(static_cast<F*>(storage))->~F(); }
+
+        static constexpr VTable vtable{&invoke, &relocate, &destroy, true};
+    };
+
+    template<typename F>
+    struct Heap_Ops
+    {
+        static F*& ptr(void *storage) { return *std::launder(static_cast<F**>(storage)); }
+
+        static void invoke(void *storage) { std::invoke(*ptr(storage)); }
+        static void relocate(void *dst_storage, void *src_storage) noexcept
+        {
+            ::new (dst_storage) F*(ptr(src_storage));
+        }
+        static void destroy(void *storage) noexcept { delete ptr(storage); }
+
+        static constexpr VTable vtable{&invoke, &relocate, &destroy, false};
+    };
+
+    void reset() noexcept;
+    void take_from(Pool_Task &rhs) noexcept;
+
+    alignas(std::max_align_t) std::byte m_storage[INLINE_CAPACITY];
+    const VTable *m_vtable{nullptr};
+#ifdef DT_POOL_METRICS
+    std::chrono::steady_clock::time_point m_enqueue_time;
+#endif
+};
+
+
+template<typename Functor>
+    requires (!std::is_same_v<std::remove_cvref_t<Functor>, Pool_Task>
+              && std::is_invocable_v<std::decay_t<Functor>&>)
+Pool_Task::Pool_Task(Functor &&f)
+{
+    using stored_t = std::decay_t<Functor>;
+    if constexpr(fits_inline<stored_t>())
+    {
+        ::new (static_cast<void*>(m_storage)) stored_t(std::forward<Functor>(f));
+        m_vtable = &Inline_Ops<stored_t>::vtable;
+    }
+    else
+    {
+        ::new (static_cast<void*>(m_storage)) stored_t*(new stored_t(std::forward<Functor>(f)));
+        m_vtable = &Heap_Ops<stored_t>::vtable;
+    }
+}
+
+inline Pool_Task& Pool_Task::operator=(Pool_Task &&rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        reset();
+        take_from(rhs);
+    }
+    return *this;
+}
+
+inline void Pool_Task::reset() noexcept
+{
+    if(m_vtable != nullptr)
+    {
+        m_vtable->destroy(m_storage);
+        m_vtable = nullptr;
+    }
+}
+
+inline void Pool_Task::take_from(Pool_Task &rhs) noexcept
+{
+    if(rhs.m_vtable != nullptr)
+    {
+        rhs.m_vtable->relocate(m_storage, rhs.m_storage);
+        m_vtable = rhs.m_vtable;
+        rhs.m_vtable = nullptr;
+    }
+#ifdef DT_POOL_METRICS
+    m_enqueue_time = rhs.m_enqueue_time;
+#endif
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // POOL_TASK_H
@@ -1,8 +1,13 @@
 #include <shared_mutex>
 #include <mutex>
-#include <condition_variable>
+#include <atomic>
 #include <cassert>
-#include <queue>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 
 
 #ifndef PRIORITYMUTEX_H
@@ -19,10 +24,168 @@ namespace NS_priority_mutex
 
 constexpr int DEFAULT_PRIORITY = 100;
 
+/*!
+ * \brief How long a contended lock call spins before it parks the thread.
+ * Spinning only pays off if the holder runs on another core and leaves its critical section soon,
+ * so on single core machines the spin phase is always skipped.
+ */
+struct Spin_Config
+{
+    static constexpr unsigned int DEFAULT_MAX_SPINS = 2000;
+
+    unsigned int max_spins{DEFAULT_MAX_SPINS}; //Upper bound of pause rounds before parking. 0 disables spinning
+    bool adaptive{true}; //Learn the budget from recent lock calls of this mutex, otherwise always spin up to max_spins
+};
+
+namespace NS_detail
+{
+
+//Tells the CPU that we are in a spin loop: saves power and frees resources for the other hyperthread
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+enum class Spin_Step { Done, Retry, Abort };
+
+//Keeps per-thread counters apart, so they do not share a cache line
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+//Deadline of untimed lock calls
+constexpr std::chrono::steady_clock::time_point NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+//Converts a relative timeout to a steady deadline, saturating at NO_DEADLINE
+template<typename Rep, typename Period>
+std::chrono::steady_clock::time_point deadline_after(const std::chrono::duration<Rep, Period> &rel_time)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(std::chrono::duration<double>(rel_time) >= std::chrono::duration<double>(NO_DEADLINE - now))
+    {
+        return NO_DEADLINE;
+    }
+    return now + std::chrono::ceil<std::chrono::steady_clock::duration>(rel_time);
+}
+
+/*!
+ * \brief Spin budget of one mutex.
+ * The budget follows twice the number of rounds recent successful spins needed, and decays after failed spins.
+ * It never drops below MIN_SPINS, so a mutex whose critical sections became shorter learns to spin again.
+ */
+class Adaptive_Spinner
+{
+public:
+    explicit Adaptive_Spinner(const Spin_Config &config);
+
+    /*!
+     * \brief Calls step() with a pause in between until it returns Done or Abort, or the budget is used up.
+     * \return True if step() returned Done
+     */
+    template<typename Step_Fn>
+    bool spin(Step_Fn step)
+    {
+        const unsigned int budget = mBudget.load(std::memory_order_relaxed);
+        for(unsigned int spins = 0; spins < budget; ++spins)
+        {
+            const Spin_Step result = step();
+            if(result != Spin_Step::Retry)
+            {
+                if(result == Spin_Step::Done)
+                {
+                    learn(spins, true);
+                }
+                return result == Spin_Step::Done;
+            }
+            cpu_relax();
+        }
+        if(budget != 0)
+        {
+            learn(budget, false);
+        }
+        return false;
+    }
+
+    [[nodiscard]] unsigned int budget() const noexcept { return mBudget.load(std::memory_order_relaxed); }
+
+private:
+    void learn(unsigned int spins, bool success) noexcept;
+
+    static constexpr unsigned int MIN_SPINS = 16;
+
+    const unsigned int mMax_spins;
+    const bool mAdaptive;
+    std::atomic<unsigned int> mBudget;
+};
+
+enum class Lock_Kind { Exclusive, Shared, Upgrade };
+
+//A thread blocked in a priority mutex. Lives on the waiting thread's stack, prev and next are guarded by the mutex's internal mutex
+struct Lock_Waiter
+{
+    static constexpr std::uint32_t WAITING = 0;
+    static constexpr std::uint32_t PARKED = 1; //Sleeps on grant_state, granting has to wake it
+    static constexpr std::uint32_t WAKING = 2; //Granted, the granting thread still uses grant_state
+    static constexpr std::uint32_t GRANTED = 3; //The waiter owns the lock and may leave
+
+    explicit Lock_Waiter(int IN_priority, Lock_Kind IN_kind = Lock_Kind::Exclusive) : priority(IN_priority), kind(IN_kind) {}
+
+    const int priority;
+    const Lock_Kind kind;
+    std::atomic<std::uint32_t> grant_state{WAITING};
+    Lock_Waiter *prev{nullptr};
+    Lock_Waiter *next{nullptr};
+};
+
+//Hands the lock to a dequeued waiter. Only makes a wake-up system call if the waiter already parked
+void grant(Lock_Waiter &waiter) noexcept;
+
+/*!
+ * \brief Spins with the mutex's budget, then parks until grant() was called for the waiter or the deadline passed.
+ * \return False on timeout. The waiter is still queued then, and the caller has to take the mutex's internal mutex
+ *         and check grant_state again before it removes the waiter: it may have been granted in the meantime.
+ */
+bool wait_for_grant(Lock_Waiter &waiter, Adaptive_Spinner &spinner, std::chrono::steady_clock::time_point deadline = NO_DEADLINE) noexcept;
+
+/*!
+ * \brief Intrusive queue of waiters, highest priority first and FIFO within a priority.
+ * front() is O(1), push() and remove() are O(log number of priorities). Not synchronized.
+ */
+class Waiter_Queue
+{
+public:
+    void push(Lock_Waiter &waiter);
+    void remove(Lock_Waiter &waiter);
+    [[nodiscard]] Lock_Waiter* front() const { return mLevels.empty() ? nullptr : mLevels.begin()->second.head; }
+    [[nodiscard]] bool empty() const { return mLevels.empty(); }
+
+private:
+    struct Level
+    {
+        Lock_Waiter *head{nullptr};
+        Lock_Waiter *tail{nullptr};
+    };
+
+    std::map<int, Level, std::greater<int>> mLevels; //Only levels with waiters
+};
+
+} //NS_detail
+
+/*!
+ * \brief Exclusive lock where waiters are served by priority (higher first) and FIFO within a priority.
+ *        Uncontended locking and unlocking is a single CAS. A contended lock() spins (see Spin_Config)
+ *        as long as nobody is queued, then queues up and parks on a futex.
+ *        unlock() hands the lock directly to the next waiter and wakes only that one.
+ *        Satisfies TimedLockable: a timed out waiter leaves the queue, so it never holds up the waiters behind it.
+ */
 class Priority_Mutex {
 public:
-    Priority_Mutex() = default;
-    ~Priority_Mutex() { assert(!locked); }
+    explicit Priority_Mutex(const Spin_Config &spin_config = Spin_Config{}) : mSpinner(spin_config) {}
+    ~Priority_Mutex() { assert(mState.load() == 0); }
 
     Priority_Mutex(const Priority_Mutex&) = delete;
     Priority_Mutex operator=(const Priority_Mutex&) = delete;
@@ -31,26 +194,267 @@ public:
 
     void lock(int priorityLvl = DEFAULT_PRIORITY);
 
+    //Never waits, so the priority does not matter: a free mutex has no waiters that could outrank the caller
+    [[nodiscard]] bool try_lock(int priorityLvl = DEFAULT_PRIORITY);
+
+    template<typename Rep, typename Period>
+    [[nodiscard]] bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return lock_until(priorityLvl, NS_detail::deadline_after(rel_time));
+    }
+
+    template<typename Clock, typename Duration>
+    [[nodiscard]] bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return lock_until(priorityLvl, NS_detail::deadline_after(abs_time - Clock::now()));
+    }
+
     void unlock();
 
+    [[nodiscard]] unsigned int spin_budget() const noexcept { return mSpinner.budget(); }
+
 private:
-    std::condition_variable mCondV;
-    std::mutex mMut;
-    bool locked{false};
-    std::priority_queue<int> lockPriorities;
+    static constexpr std::uint32_t LOCKED = 0x1;
+    static constexpr std::uint32_t QUEUED = 0x2; //Waiters are queued or a slow path call is deciding, fast paths must not acquire
+
+    bool lock_until(int priorityLvl, std::chrono::steady_clock::time_point deadline);
+    bool lock_slow(int priorityLvl, std::chrono::steady_clock::time_point deadline);
+
+    std::atomic<std::uint32_t> mState{0};
+    std::mutex mAdminMut; //Guards mWaiters, only taken on contention
+    NS_detail::Waiter_Queue mWaiters;
+    NS_detail::Adaptive_Spinner mSpinner;
+};
+
+//Fairness policies decide whether a shared request may join a held shared lock while waiters are queued
+//Joins unless a queued waiter has at least its priority, so readers cannot starve writers
+struct Priority_Fairness
+{
+    [[nodiscard]] static constexpr bool may_join(int priorityLvl, int waiting_priorityLvl) noexcept { return priorityLvl > waiting_priorityLvl; }
+};
+
+//Always joins: highest read throughput, but a steady stream of readers starves writers
+struct Reader_Preference
+{
+    [[nodiscard]] static constexpr bool may_join(int, int) noexcept { return true; }
+};
+
+//Never joins: every request waits behind the queued ones, whatever their priorities
+struct Writer_Preference
+{
+    [[nodiscard]] static constexpr bool may_join(int, int) noexcept { return false; }
 };
 
+//Waiting policies decide what a contended call does before it parks
+//Spins as configured by Spin_Config, then parks on a futex
+struct Spin_Then_Park
+{
+    static constexpr bool spins = true;
+};
+
+//Parks right away, for oversubscribed machines where the holder is unlikely to be running
+struct Park
+{
+    static constexpr bool spins = false;
+};
+
+//The slow paths are compiled in SharedPriorityMutex.cpp for exactly these policies, other ones would not link
+template<typename Policy>
+concept Supported_Fairness_Policy = std::same_as<Policy, Priority_Fairness> || std::same_as<Policy, Reader_Preference>
+                                    || std::same_as<Policy, Writer_Preference>;
+
+template<typename Policy>
+concept Supported_Wait_Policy = std::same_as<Policy, Spin_Then_Park> || std::same_as<Policy, Park>;
+
+namespace NS_detail
+{
+
+/*!
+ * \brief State and algorithm of the shared priority mutexes, without virtual calls.
+ *        The uncontended paths are inline, the slow paths live in SharedPriorityMutex.cpp
+ *        and are instantiated for the fairness and waiting policies of this header.
+ */
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+class Shared_Lock_Core
+{
+public:
+    explicit Shared_Lock_Core(const Spin_Config &spin_config) : mSpinner(Wait_Policy::spins ? spin_config : Spin_Config{0, false}) {}
+    ~Shared_Lock_Core() { assert(mState.load() == 0); }
+
+    Shared_Lock_Core(const Shared_Lock_Core&) = delete;
+    Shared_Lock_Core operator=(const Shared_Lock_Core&) = delete;
+    Shared_Lock_Core(Shared_Lock_Core&&) = delete;
+    Shared_Lock_Core operator=(Shared_Lock_Core &&) = delete;
+
+    //A free lock has no waiters that could outrank the caller
+    [[nodiscard]] bool try_lock() noexcept
+    {
+        std::uint64_t expected = 0;
+        return mState.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    bool lock_until(int priorityLvl, std::chrono::steady_clock::time_point deadline)
+    {
+        return try_lock() || lock_contended(priorityLvl, deadline);
+    }
+
+    void unlock()
+    {
+        std::uint64_t expected = WRITER;
+        if(!mState.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed))
+        {
+            unlock_slow();
+        }
+    }
+
+    [[nodiscard]] bool try_lock_shared(int priorityLvl);
+
+    bool lock_shared_until(int priorityLvl, std::chrono::steady_clock::time_point deadline)
+    {
+        std::uint64_t state = mState.load(std::memory_order_relaxed);
+        while((state & (WRITER | QUEUED)) == 0)
+        {
+            if(mState.compare_exchange_weak(state, state + READER, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return lock_shared_contended(priorityLvl, deadline);
+    }
+
+    void unlock_shared()
+    {
+        const std::uint64_t prev_state = mState.fetch_sub(READER, std::memory_order_release);
+        //Only the last reader can unblock waiters. If they queue up after the decrement, they see the free lock themselves
+        if((prev_state & QUEUED) && (prev_state & READER_MASK) == READER)
+        {
+            release_queued();
+        }
+    }
+
+    void lock_upgrade(int priorityLvl);
+    void unlock_upgrade();
+    void unlock_upgrade_and_lock();
+    void unlock_and_lock_upgrade(int priorityLvl);
+    void unlock_upgrade_and_lock_shared();
+    void unlock_and_lock_shared();
+
+    [[nodiscard]] unsigned int spin_budget() const noexcept { return mSpinner.budget(); }
+
+private:
+    static constexpr std::uint64_t WRITER = 0x1;
+    static constexpr std::uint64_t QUEUED = 0x2; //Waiters are queued or a slow path call is deciding, fast paths must not acquire
+    static constexpr std::uint64_t UPGRADER = 0x4;
+    static constexpr std::uint64_t READER = 0x8; //Reader count starts at this bit
+    static constexpr std::uint64_t READER_MASK = ~(WRITER | QUEUED | UPGRADER);
+
+    [[nodiscard]] static bool compatible(Lock_Kind kind, std::uint64_t state);
+    [[nodiscard]] static std::uint64_t holder_bits(Lock_Kind kind);
+
+    bool lock_contended(int priorityLvl, std::chrono::steady_clock::time_point deadline);
+    bool lock_shared_contended(int priorityLvl, std::chrono::steady_clock::time_point deadline);
+    void unlock_slow();
+    bool lock_slow(int priorityLvl, Lock_Kind kind, std::chrono::steady_clock::time_point deadline);
+    [[nodiscard]] bool try_admit(int priorityLvl, Lock_Kind kind); //Caller must hold mAdminMut
+    void grant_waiters(); //Caller must hold mAdminMut
+    void release_queued(); //Takes mAdminMut and grants the waiters that fit in now
+    [[nodiscard]] bool has_waiters() const { return !mWaiters.empty() || mUpgrading != nullptr; } //Caller must hold mAdminMut
+
+    std::atomic<std::uint64_t> mState{0};
+    std::mutex mAdminMut; //Guards mWaiters and mUpgrading, only taken on contention
+    Waiter_Queue mWaiters;
+    Lock_Waiter *mUpgrading{nullptr}; //Upgrade holder waiting for the readers to leave. Not queued, nobody else can get in before it
+    int mUpgrade_priority{DEFAULT_PRIORITY}; //Only accessed by the upgrade holder
+    Adaptive_Spinner mSpinner;
+};
+
+} //NS_detail
+
 /*!
  * \brief Shared and non-shared locking with priorities.
  *        Locking with the same priority using lock_shared creates a normal shared lock.
  *        If the priority is not high enough, or the current lock is not shared, the call blocks.
  *        The default value is 100.
+ *        The lock state is one atomic word: without waiters, locking and unlocking is a single CAS or fetch_add.
+ *        Only contended calls queue up by priority (FIFO within a priority) under an internal mutex.
+ *        With Priority_Fairness, a shared request joins a shared lock unless a waiter of at least its priority is queued.
+ *        Releasing the lock hands it to the front waiter, or to all shared waiters in front of the first exclusive one.
+ *        Before queueing, contended calls spin as configured by Spin_Config, unless Wait_Policy is Park.
+ *        Satisfies TimedLockable and SharedTimedLockable. A timed out waiter leaves the queue and, if it was in front,
+ *        lets the waiters behind it join the current shared lock.
+ *        An upgrade lock (lock_upgrade) coexists with shared locks but excludes other upgrade and exclusive locks.
+ *        Its holder can turn it into an exclusive lock without releasing it, and keeps its priority while it waits
+ *        for the readers to leave: only readers that outrank it still join. Exclusive and upgrade locks can be downgraded.
+ *        Bias is added to the priority of exclusive and upgrade requests and subtracted from shared ones.
+ *        Nothing is virtual, so all policies are resolved at compile time and the uncontended paths inline.
+ */
+template<int Bias = 0, Supported_Fairness_Policy Fairness_Policy = Priority_Fairness, Supported_Wait_Policy Wait_Policy = Spin_Then_Park>
+class Basic_Shared_Priority_Mutex
+{
+public:
+    explicit Basic_Shared_Priority_Mutex(const Spin_Config &spin_config = Spin_Config{}) : mCore(spin_config) {}
+
+    Basic_Shared_Priority_Mutex(const Basic_Shared_Priority_Mutex&) = delete;
+    Basic_Shared_Priority_Mutex operator=(const Basic_Shared_Priority_Mutex&) = delete;
+    Basic_Shared_Priority_Mutex(Basic_Shared_Priority_Mutex&&) = delete;
+    Basic_Shared_Priority_Mutex operator=(Basic_Shared_Priority_Mutex &&) = delete;
+
+    void lock(int priorityLvl = DEFAULT_PRIORITY) { mCore.lock_until(priorityLvl + Bias, NS_detail::NO_DEADLINE); }
+    void lock_shared(int priorityLvl = DEFAULT_PRIORITY) { mCore.lock_shared_until(priorityLvl - Bias, NS_detail::NO_DEADLINE); }
+
+    [[nodiscard]] bool try_lock(int = DEFAULT_PRIORITY) { return mCore.try_lock(); }
+    [[nodiscard]] bool try_lock_shared(int priorityLvl = DEFAULT_PRIORITY) { return mCore.try_lock_shared(priorityLvl - Bias); }
+
+    template<typename Clock, typename Duration>
+    [[nodiscard]] bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return mCore.lock_until(priorityLvl + Bias, NS_detail::deadline_after(abs_time - Clock::now()));
+    }
+
+    template<typename Clock, typename Duration>
+    [[nodiscard]] bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration> &abs_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return mCore.lock_shared_until(priorityLvl - Bias, NS_detail::deadline_after(abs_time - Clock::now()));
+    }
+
+    template<typename Rep, typename Period>
+    [[nodiscard]] bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return mCore.lock_until(priorityLvl + Bias, NS_detail::deadline_after(rel_time));
+    }
+
+    template<typename Rep, typename Period>
+    [[nodiscard]] bool try_lock_shared_for(const std::chrono::duration<Rep, Period> &rel_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return mCore.lock_shared_until(priorityLvl - Bias, NS_detail::deadline_after(rel_time));
+    }
+
+    void unlock() { mCore.unlock(); }
+    void unlock_shared() { mCore.unlock_shared(); }
+
+    void lock_upgrade(int priorityLvl = DEFAULT_PRIORITY) { mCore.lock_upgrade(priorityLvl + Bias); }
+    void unlock_upgrade() { mCore.unlock_upgrade(); }
+
+    void unlock_upgrade_and_lock() { mCore.unlock_upgrade_and_lock(); } //Blocks until the readers left, with the priority of lock_upgrade()
+    void unlock_and_lock_upgrade(int priorityLvl = DEFAULT_PRIORITY) { mCore.unlock_and_lock_upgrade(priorityLvl + Bias); }
+    void unlock_upgrade_and_lock_shared() { mCore.unlock_upgrade_and_lock_shared(); }
+    void unlock_and_lock_shared() { mCore.unlock_and_lock_shared(); }
+
+    [[nodiscard]] unsigned int spin_budget() const noexcept { return mCore.spin_budget(); }
+
+private:
+    NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy> mCore;
+};
+
+/*!
+ * \brief Basic_Shared_Priority_Mutex with the default policies behind virtual calls, for subclasses that adjust priorities
+ *        or the read path at runtime. Prefer Basic_Shared_Priority_Mutex if the configuration is known at compile time.
  */
 class Shared_Priority_Mutex
 {
 public:
-    Shared_Priority_Mutex() = default;
-    virtual ~Shared_Priority_Mutex() { assert(lock_counter == 0); }
+    explicit Shared_Priority_Mutex(const Spin_Config &spin_config = Spin_Config{}) : mCore(spin_config) {}
+    virtual ~Shared_Priority_Mutex() = default;
 
     Shared_Priority_Mutex(const Shared_Priority_Mutex&) = delete;
     Shared_Priority_Mutex operator=(const Shared_Priority_Mutex&) = delete;
@@ -60,19 +464,51 @@ public:
     virtual void lock(int priorityLvl = DEFAULT_PRIORITY);
     virtual void lock_shared(int priorityLvl = DEFAULT_PRIORITY);
 
+    [[nodiscard]] virtual bool try_lock(int priorityLvl = DEFAULT_PRIORITY);
+    [[nodiscard]] virtual bool try_lock_shared(int priorityLvl = DEFAULT_PRIORITY);
+
+    [[nodiscard]] virtual bool try_lock_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY);
+    [[nodiscard]] virtual bool try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY);
+
+    template<typename Clock, typename Duration>
+    [[nodiscard]] bool try_lock_until(const std::chrono::time_point<Clock, Duration> &abs_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return try_lock_until(NS_detail::deadline_after(abs_time - Clock::now()), priorityLvl);
+    }
+
+    template<typename Clock, typename Duration>
+    [[nodiscard]] bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration> &abs_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return try_lock_shared_until(NS_detail::deadline_after(abs_time - Clock::now()), priorityLvl);
+    }
+
+    template<typename Rep, typename Period>
+    [[nodiscard]] bool try_lock_for(const std::chrono::duration<Rep, Period> &rel_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return try_lock_until(NS_detail::deadline_after(rel_time), priorityLvl);
+    }
+
+    template<typename Rep, typename Period>
+    [[nodiscard]] bool try_lock_shared_for(const std::chrono::duration<Rep, Period> &rel_time, int priorityLvl = DEFAULT_PRIORITY)
+    {
+        return try_lock_shared_until(NS_detail::deadline_after(rel_time), priorityLvl);
+    }
+
     virtual void unlock();
     virtual void unlock_shared();
 
+    virtual void lock_upgrade(int priorityLvl = DEFAULT_PRIORITY);
+    virtual void unlock_upgrade();
+
+    virtual void unlock_upgrade_and_lock(); //Blocks until the readers left, with the priority of lock_upgrade()
+    virtual void unlock_and_lock_upgrade(int priorityLvl = DEFAULT_PRIORITY);
+    virtual void unlock_upgrade_and_lock_shared();
+    virtual void unlock_and_lock_shared();
+
+    [[nodiscard]] unsigned int spin_budget() const noexcept { return mCore.spin_budget(); }
 
 private:
-    std::condition_variable_any mCondV;
-    std::shared_mutex mMut;
-    std::mutex internal_admin_mutex; //used to manipulate internal queue and is_shared_lock even if shared lock is used
-    unsigned long lock_counter{0}; //How many clients lock the main mutex right now?
-    bool is_shared_lock{false};
-    std::priority_queue<int> lockPriorities;
-
-    static constexpr unsigned long MAX_NUM_LOCK_COUNTER = std::numeric_limits<unsigned long>::max();
+    NS_detail::Shared_Lock_Core<Priority_Fairness, Spin_Then_Park> mCore;
 };
 
 
@@ -84,7 +520,7 @@ private:
 class Biased_Shared_Priority_Mutex : public Shared_Priority_Mutex
 {
 public:
-    Biased_Shared_Priority_Mutex(int IN_bias) : mBias(IN_bias) {};
+    Biased_Shared_Priority_Mutex(int IN_bias, const Spin_Config &spin_config = Spin_Config{}) : Shared_Priority_Mutex(spin_config), mBias(IN_bias) {};
     ~Biased_Shared_Priority_Mutex() override = default;
 
     Biased_Shared_Priority_Mutex(const Biased_Shared_Priority_Mutex&) = delete;
@@ -95,12 +531,83 @@ public:
     void lock(int priorityLvl = DEFAULT_PRIORITY) override;
     void lock_shared(int priorityLvl = DEFAULT_PRIORITY) override;
 
+    [[nodiscard]] bool try_lock(int priorityLvl = DEFAULT_PRIORITY) override;
+    [[nodiscard]] bool try_lock_shared(int priorityLvl = DEFAULT_PRIORITY) override;
+
+    using Shared_Priority_Mutex::try_lock_until;
+    using Shared_Priority_Mutex::try_lock_shared_until;
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY) override;
+    [[nodiscard]] bool try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY) override;
+
+    void lock_upgrade(int priorityLvl = DEFAULT_PRIORITY) override;
+    void unlock_and_lock_upgrade(int priorityLvl = DEFAULT_PRIORITY) override;
+
 private:
     int mBias{0};
 
 };
 
 
+/*!
+ * \brief Shared_Priority_Mutex for read-mostly data, with distributed reader counters (BRAVO-style visible readers).
+ *        While the mutex is read biased, lock_shared() only increments a per-thread slot on its own cache line
+ *        and never touches the shared lock word, so read-lock throughput scales with the number of cores.
+ *        These fast readers ignore queued waiters. A writer takes the underlying lock, revokes the bias
+ *        and waits until all slots are drained, after that readers go through the priority queue as usual.
+ *        The bias is restored by the next reader that comes REBIAS_FACTOR times the last revocation time later,
+ *        so write-heavy phases do not pay for a revocation on every lock.
+ *        Shared locking is not recursive: a thread that already holds a read lock must not call lock_shared() again.
+ *        If a writer revokes the bias in between, it holds the underlying lock while it waits for the outer read lock
+ *        to drain, and the nested lock_shared() queues behind that writer, so both wait forever.
+ */
+class Distributed_Shared_Priority_Mutex : public Shared_Priority_Mutex
+{
+public:
+    explicit Distributed_Shared_Priority_Mutex(const Spin_Config &spin_config = Spin_Config{});
+    ~Distributed_Shared_Priority_Mutex() override = default;
+
+    Distributed_Shared_Priority_Mutex(const Distributed_Shared_Priority_Mutex&) = delete;
+    Distributed_Shared_Priority_Mutex operator=(const Distributed_Shared_Priority_Mutex&) = delete;
+    Distributed_Shared_Priority_Mutex(Distributed_Shared_Priority_Mutex&&) = delete;
+    Distributed_Shared_Priority_Mutex operator=(Distributed_Shared_Priority_Mutex &&) = delete;
+
+    void lock(int priorityLvl = DEFAULT_PRIORITY) override;
+    void lock_shared(int priorityLvl = DEFAULT_PRIORITY) override;
+
+    [[nodiscard]] bool try_lock(int priorityLvl = DEFAULT_PRIORITY) override;
+    [[nodiscard]] bool try_lock_shared(int priorityLvl = DEFAULT_PRIORITY) override;
+
+    using Shared_Priority_Mutex::try_lock_until;
+    using Shared_Priority_Mutex::try_lock_shared_until;
+    [[nodiscard]] bool try_lock_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY) override;
+    [[nodiscard]] bool try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int priorityLvl = DEFAULT_PRIORITY) override;
+
+    void unlock_shared() override;
+
+    void unlock_upgrade_and_lock() override;
+
+    [[nodiscard]] bool read_biased() const noexcept { return mRead_bias.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(NS_detail::CACHE_LINE_SIZE) Reader_Slot
+    {
+        std::atomic<std::uint32_t> count{0};
+    };
+
+    static constexpr int REBIAS_FACTOR = 9;
+
+    [[nodiscard]] Reader_Slot& own_slot() const noexcept;
+    [[nodiscard]] bool try_lock_fast_shared();
+    bool revoke_bias(std::chrono::steady_clock::time_point deadline); //Caller must hold the underlying lock exclusively
+    void rebias(); //Caller must hold the underlying lock shared
+
+    std::unique_ptr<Reader_Slot[]> mSlots;
+    std::size_t mSlot_mask;
+    std::atomic<bool> mRead_bias{true};
+    std::atomic<std::chrono::steady_clock::rep> mInhibit_until{0}; //No rebias before this steady_clock tick count
+};
+
+
 
 }
 
@@ -0,0 +1,206 @@
+#ifndef PRIORITY_TASK_QUEUE_H
+#define PRIORITY_TASK_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Multi-level queue with aging.
+ * Every priority level is a FIFO. pop() takes the front of the level with the highest effective priority,
+ * which is the level plus one for every aging interval the front element has been waiting.
+ * So low priority elements cannot starve, they eventually overtake any fixed priority.
+ * Upper bounds of the highest level and the oldest element are mirrored in atomics,
+ * so callers can skip the lock when nothing in the queue can reach the priority they are interested in.
+ */
+template<typename T>
+class Priority_Task_Queue
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit Priority_Task_Queue(clock::duration aging_interval = std::chrono::milliseconds(10))
+        : mAging_interval_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(aging_interval).count()) {}
+
+    void push(int priority, T &&IN_element); //blocking
+    [[nodiscard]] bool pop(T &OUT_element, int min_priority = std::numeric_limits<int>::min()); //retval false if no element has at least min_priority
+    [[nodiscard]] bool may_contain(int min_priority) const; //non-blocking, may return false positives
+    [[nodiscard]] bool empty() const; //non-blocking
+    [[nodiscard]] std::size_t size() const; //non-blocking
+    [[nodiscard]] std::map<int, std::size_t> level_sizes() const; //blocking
+    std::size_t clear(); //retval is the number of discarded elements
+
+    void set_aging_interval(clock::duration aging_interval);
+
+private:
+    struct Entry
+    {
+        T element;
+        clock::time_point enqueue_time;
+    };
+
+    [[nodiscard]] int effective_priority(int priority, clock::time_point enqueue_time, clock::time_point now) const;
+    void update_hints(); //Caller must hold mMut
+
+    mutable std::mutex mMut;
+    std::map<int, std::deque<Entry>> mLevels; //Empty levels are removed
+    std::atomic<std::size_t> mSize{0};
+    std::atomic<int> mMax_level{std::numeric_limits<int>::min()};
+    std::atomic<clock::rep> mOldest_enqueue_time{std::numeric_limits<clock::rep>::max()};
+    std::atomic<std::chrono::nanoseconds::rep> mAging_interval_ns;
+};
+
+
+template<typename T>
+void Priority_Task_Queue<T>::push(int priority, T &&IN_element)
+{
+    std::lock_guard<std::mutex> lk(mMut);
+    mLevels[priority].push_back(Entry{std::move(IN_element), clock::now()});
+    //Hints first, so that a non-zero size is never seen together with stale hints of an empty queue
+    update_hints();
+    mSize.fetch_add(1);
+}
+
+template<typename T>
+bool Priority_Task_Queue<T>::pop(T &OUT_element, int min_priority)
+{
+    if(!may_contain(min_priority))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(mMut);
+    const clock::time_point now = clock::now();
+    auto best_level = mLevels.end();
+    int best_priority = min_priority;
+    for(auto level = mLevels.begin(); level != mLevels.end(); ++level)
+    {
+        //Ties go to the higher level, which comes later in the map
+        const int curr_priority = effective_priority(level->first, level->second.front().enqueue_time, now);
+        if(curr_priority >= best_priority)
+        {
+            best_priority = curr_priority;
+            best_level = level;
+        }
+    }
+
+    if(best_level == mLevels.end())
+    {
+        return false;
+    }
+
+    OUT_element = std::move(best_level->second.front().element);
+    best_level->second.pop_front();
+    if(best_level->second.empty())
+    {
+        mLevels.erase(best_level);
+    }
+    mSize.fetch_sub(1);
+    update_hints();
+    return true;
+}
+
+template<typename T>
+bool Priority_Task_Queue<T>::may_contain(int min_priority) const
+{
+    if(empty())
+    {
+        return false;
+    }
+    const clock::time_point oldest_enqueue_time{clock::duration{mOldest_enqueue_time.load()}};
+    return effective_priority(mMax_level.load(), oldest_enqueue_time, clock::now()) >= min_priority;
+}
+
+template<typename T>
+bool Priority_Task_Queue<T>::empty() const
+{
+    return mSize.load() == 0;
+}
+
+template<typename T>
+std::size_t Priority_Task_Queue<T>::size() const
+{
+    return mSize.load();
+}
+
+template<typename T>
+std::map<int, std::size_t> Priority_Task_Queue<T>::level_sizes() const
+{
+    std::map<int, std::size_t> result;
+    std::lock_guard<std::mutex> lk(mMut);
+    for(const auto &[priority, level] : mLevels)
+    {
+        result[priority] = level.size();
+    }
+    return result;
+}
+
+template<typename T>
+std::size_t Priority_Task_Queue<T>::clear()
+{
+    std::map<int, std::deque<Entry>> discarded;
+    std::size_t num_discarded = 0;
+    {
+        std::lock_guard<std::mutex> lk(mMut);
+        discarded.swap(mLevels);
+        num_discarded = mSize.exchange(0);
+        update_hints();
+    }
+    //Elements are destroyed outside of the lock
+    return num_discarded;
+}
+
+template<typename T>
+void Priority_Task_Queue<T>::set_aging_interval(clock::duration aging_interval)
+{
+    mAging_interval_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(aging_interval).count());
+}
+
+template<typename T>
+int Priority_Task_Queue<T>::effective_priority(int priority, clock::time_point enqueue_time, clock::time_point now) const
+{
+    const std::chrono::nanoseconds::rep aging_interval_ns = mAging_interval_ns.load(std::memory_order_relaxed);
+    if(aging_interval_ns <= 0 || now <= enqueue_time)
+    {
+        return priority;
+    }
+
+    //Saturate instead of overflowing for very old elements
+    const long long age_steps = std::chrono::duration_cast<std::chrono::nanoseconds>(now - enqueue_time).count() / aging_interval_ns;
+    const long long boosted = static_cast<long long>(priority) + age_steps;
+    return static_cast<int>(std::min<long long>(boosted, std::numeric_limits<int>::max()));
+}
+
+template<typename T>
+void Priority_Task_Queue<T>::update_hints()
+{
+    if(mLevels.empty())
+    {
+        mMax_level.store(std::numeric_limits<int>::min());
+        mOldest_enqueue_time.store(std::numeric_limits<clock::rep>::max());
+        return;
+    }
+
+    clock::time_point oldest_enqueue_time = clock::time_point::max();
+    for(const auto &[priority, level] : mLevels)
+    {
+        oldest_enqueue_time = std::min(oldest_enqueue_time, level.front().enqueue_time);
+    }
+    mMax_level.store(mLevels.rbegin()->first);
+    mOldest_enqueue_time.store(oldest_enqueue_time.time_since_epoch().count());
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // PRIORITY_TASK_QUEUE_H
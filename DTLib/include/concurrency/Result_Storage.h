@@ -0,0 +1,66 @@
+#ifndef RESULT_STORAGE_H
+#define RESULT_STORAGE_H
+
+#include <exception>
+#include <utility>
+#include <variant>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Result of an asynchronous operation: either nothing yet, a value or an exception.
+ * Not synchronized, the owner has to publish it to other threads.
+ */
+template<typename T>
+class Result_Storage
+{
+public:
+    template<typename U>
+    void set_value(U &&value) { m_result.template emplace<1>(std::forward<U>(value)); }
+    void set_exception(std::exception_ptr error) { m_result.template emplace<2>(std::move(error)); }
+
+    [[nodiscard]] bool has_exception() const noexcept { return m_result.index() == 2; }
+    [[nodiscard]] std::exception_ptr exception() const { return has_exception() ? std::get<2>(m_result) : nullptr; }
+
+    //Moves the value out or rethrows the exception
+    T get()
+    {
+        if(has_exception())
+        {
+            std::rethrow_exception(std::get<2>(m_result));
+        }
+        return std::move(std::get<1>(m_result));
+    }
+private:
+    std::variant<std::monostate, T, std::exception_ptr> m_result;
+};
+
+template<>
+class Result_Storage<void>
+{
+public:
+    void set_value() {}
+    void set_exception(std::exception_ptr error) { m_error = std::move(error); }
+
+    [[nodiscard]] bool has_exception() const noexcept { return m_error != nullptr; }
+    [[nodiscard]] std::exception_ptr exception() const { return m_error; }
+
+    void get()
+    {
+        if(m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+private:
+    std::exception_ptr m_error;
+};
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // RESULT_STORAGE_H
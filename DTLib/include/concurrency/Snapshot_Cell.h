@@ -0,0 +1,166 @@
+#ifndef SNAPSHOT_CELL_H
+#define SNAPSHOT_CELL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "PriorityMutex.h"
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Holds a small trivially copyable value behind a sequence lock.
+ * load() takes no lock and writes nothing: it copies the value and retries if a store() overlapped the copy.
+ * Readers therefore never block the writer and do not contend with each other,
+ * but a reader may retry while stores happen back to back.
+ * The value is kept in atomic words so that the racing copy is well defined.
+ * Only one store() may run at a time, the caller has to serialize them.
+ */
+template<typename T>
+class Seqlock_Cell
+{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>,
+            "Seqlock_Cell: T must be trivially copyable and default constructible");
+public:
+    Seqlock_Cell() = default;
+    explicit Seqlock_Cell(const T &IN_val);
+
+    void store(const T &IN_val);
+    [[nodiscard]] T load() const;
+
+    Seqlock_Cell& operator =(const Seqlock_Cell&) = delete;
+    Seqlock_Cell(const Seqlock_Cell&) = delete;
+private:
+    static constexpr std::size_t NUM_WORDS = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint32_t> mSeq{0}; //Odd while a store() is running
+    std::array<std::atomic<std::uint64_t>, NUM_WORDS> mWords{};
+};
+
+template<typename T>
+Seqlock_Cell<T>::Seqlock_Cell(const T &IN_val)
+{
+    store(IN_val);
+}
+
+template<typename T>
+void Seqlock_Cell<T>::store(const T &IN_val)
+{
+    std::array<std::uint64_t, NUM_WORDS> words{};
+    std::memcpy(words.data(), &IN_val, sizeof(T));
+
+    const std::uint32_t seq = mSeq.load(std::memory_order_relaxed);
+    mSeq.store(seq + 1, std::memory_order_relaxed);
+    //Readers that see any of the new words must also see the odd sequence number
+    std::atomic_thread_fence(std::memory_order_release);
+    for(std::size_t i = 0; i < NUM_WORDS; ++i)
+    {
+        mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSeq.store(seq + 2, std::memory_order_release);
+}
+
+template<typename T>
+T Seqlock_Cell<T>::load() const
+{
+    std::array<std::uint64_t, NUM_WORDS> words;
+    while(true)
+    {
+        const std::uint32_t seq = mSeq.load(std::memory_order_acquire);
+        if(seq & 1)
+        {
+            NS_priority_mutex::NS_detail::cpu_relax();
+            continue;
+        }
+        for(std::size_t i = 0; i < NUM_WORDS; ++i)
+        {
+            words[i] = mWords[i].load(std::memory_order_relaxed);
+        }
+        //Orders the copy before the re-check of the sequence number
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(mSeq.load(std::memory_order_relaxed) == seq)
+        {
+            break;
+        }
+    }
+    T result;
+    std::memcpy(static_cast<void*>(&result), words.data(), sizeof(T));
+    return result;
+}
+
+
+/*!
+ * \brief Holds an immutable value behind an atomically swapped std::shared_ptr<const T> (read-copy-update).
+ * load() pins the current version without copying it, store() publishes a new version and never waits for readers to let go of old ones.
+ * Old versions are freed when the last reader that pinned them lets go.
+ * This is not lock-free: std::atomic<std::shared_ptr> is not lock-free in libstdc++ or libc++. libstdc++ guards the pointer with
+ * a spin lock bit that load() holds while it increments the reference count, and store() while it swaps the pointer.
+ * The lock is only held for those few instructions, but every load() writes the same cache line, so concurrent readers
+ * contend with each other and with store(), and a reader preempted inside load() stalls the others.
+ * A default constructed cell is empty, load() returns nullptr until the first store().
+ */
+template<typename T>
+class Snapshot_Cell
+{
+public:
+    Snapshot_Cell() = default;
+    template<typename U>
+    explicit Snapshot_Cell(U &&IN_val);
+
+    template<typename U>
+    void store(U &&IN_val);
+    void store(std::shared_ptr<const T> IN_snapshot);
+    [[nodiscard]] std::shared_ptr<const T> load() const;
+
+    Snapshot_Cell& operator =(const Snapshot_Cell&) = delete;
+    Snapshot_Cell(const Snapshot_Cell&) = delete;
+private:
+    std::atomic<std::shared_ptr<const T>> mSnapshot;
+};
+
+template<typename T> template<typename U>
+Snapshot_Cell<T>::Snapshot_Cell(U &&IN_val)
+:   mSnapshot(std::make_shared<const T>(std::forward<U>(IN_val)))
+{
+
+}
+
+template<typename T> template<typename U>
+void Snapshot_Cell<T>::store(U &&IN_val)
+{
+    store(std::make_shared<const T>(std::forward<U>(IN_val)));
+}
+
+template<typename T>
+void Snapshot_Cell<T>::store(std::shared_ptr<const T> IN_snapshot)
+{
+    mSnapshot.store(std::move(IN_snapshot), std::memory_order_release);
+}
+
+template<typename T>
+std::shared_ptr<const T> Snapshot_Cell<T>::load() const
+{
+    return mSnapshot.load(std::memory_order_acquire);
+}
+
+
+//Largest type that is read through a Seqlock_Cell. Larger values are cheaper to pin than to copy on every read.
+constexpr std::size_t SEQLOCK_MAX_SIZE = 4 * NS_priority_mutex::NS_detail::CACHE_LINE_SIZE;
+
+template<typename T>
+constexpr bool use_seqlock_v = std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> && sizeof(T) <= SEQLOCK_MAX_SIZE;
+
+//Cell that LOCKFREEREAD reads T through. Only the Seqlock_Cell is free of locks, see Snapshot_Cell for the other one
+template<typename T>
+using Lock_Free_Cell_t = std::conditional_t<use_seqlock_v<T>, Seqlock_Cell<T>, Snapshot_Cell<T>>;
+
+} //NS_concurrency
+} //NS_dtools
+#endif // SNAPSHOT_CELL_H
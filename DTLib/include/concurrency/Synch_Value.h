@@ -1,12 +1,23 @@
 #ifndef SYNCH_VALUE_H
 #define SYNCH_VALUE_H
 
-#include <queue>
 #include <mutex>
+#include <vector>
 #include <atomic>
 #include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <future>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include "Bounded_Queue.h"
 #include "PriorityMutex.h"
+#include "Snapshot_Cell.h"
 
 namespace NS_dtools
 {
@@ -16,91 +27,382 @@ namespace NS_concurrency
 
 using namespace NS_priority_mutex;
 
-enum SYNCHRONIZEDVALUEMODE: int {UPDATEINORDER = 0x1, PRIORITIZESET = 0x10, PRIORITIZEGET = 0x100};
+enum SYNCHRONIZEDVALUEMODE: int {UPDATEINORDER = 0x1, PRIORITIZESET = 0x10, PRIORITIZEGET = 0x100, LOCKFREEREAD = 0x1000};
+
+//Runs the async operations of a Synch_Value, e.g. Thread_Pool. The tasks are move-only.
+//An executor may destroy a task without running it, then the async set is abandoned and an async get's future is broken.
+template<typename Executor>
+concept Free_Post_Executor = requires(Executor &executor) { executor.post_free([](){}); };
 
 /*
  * /brief Wraps an object of type T that is either movable or copyable. Access to the wrapper is synchronized as follows:
  * get() can be called in parallel without blocking if the mode is UPDATEALWAYS and no calls to set happen at the same time.
  * set() blocks when other set(async) or get(async) calls are ongoing at the same time.
  * If the mode is UPDATEINORDER, the values set by set() are saved in a queue and get() returns them in the order they were set. If the queue is empty, the last set value is returned.
- * set and get have async versions that respect the order of calls and otherwise behave the same as their synchronous versions.
+ * The queue is a preallocated lock-free ring buffer of queue_capacity values (see Bounded_Queue.h). When it is full, set() blocks,
+ * drops the oldest value or fails and returns false, depending on backpressure. Values are moved into and out of the queue,
+ * get() copies a value once more only to keep it as the last value.
+ * set and get have async versions that run on a caller-supplied executor such as Thread_Pool.
+ * setAsync() takes its place in the order of sets when it is called. In the default mode, async sets that directly follow each other
+ * are merged into a single write as long as none of them was applied yet, so readers can never tell the difference.
+ * A sync set() waits for earlier async sets, so it must not be called from the only thread of the executor while those are queued.
+ * getAsync() is not ordered with pending async sets. The destructor waits until all async operations are done or their tasks were destroyed.
+ * Every set() or modify() that lands increments version() by one, merged async sets count once. wait_for_change() sleeps until
+ * the version differs from the one given, without using CPU. To not miss a change, read version() before reading the value.
+ * Callbacks registered with subscribe() are called with the new version after every change, on the thread that made it.
+ * Calls for different changes may overlap or arrive out of order. A callback must not change the value, subscribe or drop a Subscription.
+ * Mutex_T guards the active value. The default takes its bias from the PRIORITIZESET / PRIORITIZEGET flags of the mode at runtime,
+ * a Basic_Shared_Priority_Mutex fixes bias and policies at compile time and inlines the lock calls. Its flags in mode are ignored.
+ * If the mode is LOCKFREEREAD, get() does not take the mutex and never waits for set(). Small trivially copyable values are read through a seqlock,
+ * which takes no lock at all and does not write. Other values are read through an atomically swapped std::shared_ptr<const T>,
+ * so every set() allocates a new version. That swap is guarded by a short internal spin lock and every read bumps a shared
+ * reference count, so these reads do not scale with the number of readers (see Snapshot_Cell.h).
+ * LOCKFREEREAD cannot be combined with UPDATEINORDER, since taking a value from the queue is a write.
+ * visit() and pin() read the value without copying it, modify() changes it in place. visit() and pin() advance the queue like get().
+ * modify() is ordered like set() and changes the value set last. In UPDATEINORDER mode that value may still be in the queue,
+ * then the modification is kept aside and applied when the value is taken out, and the values before it are not touched.
  * */
-template <typename T>
+template <typename T, typename Mutex_T = Biased_Shared_Priority_Mutex>
 class Synch_Value
 {
 public:
-    Synch_Value(T&& initval, int mode = 0x0);
+    /*!
+     * \brief Read access to the value of a Synch_Value without copying it, returned by pin().
+     * In LOCKFREEREAD mode it pins the version that was current when it was created. Later sets do not change it and are not blocked by it.
+     * Small seqlock values are copied once into the handle itself, pinning them does not allocate.
+     * In the other modes it holds the read lock on the value, so every set() waits until it is destroyed. Keep it short-lived there.
+     */
+    class Pinned_Value
+    {
+    public:
+        const T& operator *() const { return *get(); }
+        const T* operator ->() const { return get(); }
+        [[nodiscard]] const T* get() const
+        {
+            if(mCopy)
+            {
+                return &*mCopy;
+            }
+            return mSnapshot ? mSnapshot.get() : mLocked_val;
+        }
+    private:
+        friend class Synch_Value;
+        explicit Pinned_Value(std::shared_ptr<const T> snapshot) : mSnapshot(std::move(snapshot)) {}
+        Pinned_Value(std::in_place_t, const T &copy) : mCopy(copy) {}
+        Pinned_Value(std::shared_lock<Mutex_T> &&readlock, const T &val) : mReadlock(std::move(readlock)), mLocked_val(&val) {}
+
+        std::shared_lock<Mutex_T> mReadlock;
+        std::shared_ptr<const T> mSnapshot;
+        const T *mLocked_val{nullptr};
+        std::optional<T> mCopy;
+    };
+
+    /*!
+     * \brief Keeps a callback of subscribe() registered. Destroying or resetting it unregisters the callback
+     * and waits until running calls of it have returned. Must not outlive the Synch_Value.
+     */
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+        ~Subscription() { reset(); }
+        Subscription(Subscription &&rhs) noexcept : mOwner(std::exchange(rhs.mOwner, nullptr)), mId(rhs.mId) {}
+        Subscription& operator =(Subscription &&rhs) noexcept
+        {
+            if(this != &rhs)
+            {
+                reset();
+                mOwner = std::exchange(rhs.mOwner, nullptr);
+                mId = rhs.mId;
+            }
+            return *this;
+        }
+        Subscription(const Subscription&) = delete;
+        Subscription& operator =(const Subscription&) = delete;
+
+        void reset()
+        {
+            if(mOwner)
+            {
+                std::exchange(mOwner, nullptr)->unsubscribe(mId);
+            }
+        }
+    private:
+        friend class Synch_Value;
+        Subscription(Synch_Value *owner, std::uint64_t id) : mOwner(owner), mId(id) {}
+
+        Synch_Value *mOwner{nullptr};
+        std::uint64_t mId{0};
+    };
+
+    static constexpr std::size_t DEFAULT_QUEUE_CAPACITY = 256;
+
+    Synch_Value(T&& initval, int mode = 0x0, std::size_t queue_capacity = DEFAULT_QUEUE_CAPACITY, Backpressure backpressure = Backpressure::Block);
     Synch_Value() = default;
-    ~Synch_Value() = default;
+    ~Synch_Value();
 
+    //Is blocking. retval false if the value was rejected by Backpressure::Fail.
+    //With Backpressure::Block (the default) and a full UPDATEINORDER queue, it waits for a get() while holding its place in the order,
+    //so every later set() and modify() waits too. A thread that calls set() or modify() before its own get() then deadlocks.
     template <typename U>
-    void set(U&& val); //Is blocking
-    template <typename U>
-    void setAsync(U&& val);
+    bool set(U&& val);
+    //A value rejected by Backpressure::Fail is dropped. With Backpressure::Block and a full queue, the task occupies a thread
+    //of the executor until a get() makes room, so get() must not depend on the same executor.
+    template <Free_Post_Executor Executor, typename U>
+    void setAsync(Executor& executor, U&& val);
 
    [[maybe_unused]] T get(); //Is blocking
-   [[maybe_unused]] std::future<T> getAsync();
+    template <Free_Post_Executor Executor>
+   [[maybe_unused]] std::future<T> getAsync(Executor& executor);
+
+    template <typename Visitor>
+    std::invoke_result_t<Visitor, const T&> visit(Visitor&& f); //Calls f(const T&) under the read lock. Is blocking
+    [[nodiscard]] Pinned_Value pin(); //Is blocking
+    template <typename Modifier>
+    void modify(Modifier&& f); //Calls f(T&) on the current value, ordered like set(). Is blocking
+
+    [[nodiscard]] std::uint64_t version() const { return mVersion.load(std::memory_order_acquire); }
+    std::uint64_t wait_for_change(std::uint64_t last_seen_version) const; //Is blocking. retval is the new version
+    [[nodiscard]] Subscription subscribe(std::function<void(std::uint64_t)> callback);
 
     Synch_Value& operator =(const Synch_Value&) = delete;
     Synch_Value(const Synch_Value&) = delete;
     Synch_Value& operator =(const Synch_Value&&) = delete;
     Synch_Value(const Synch_Value&&) = delete;
 private:
-    template <typename U>
-    void setInternal(U&& val, unsigned int orderIdx);
+    //Value of one or more merged async sets, waiting for the executor
+    struct Async_Set
+    {
+        T value;
+        unsigned int firstOrderIdx;
+        unsigned int lastOrderIdx;
+    };
+    //Outlives the Synch_Value while async tasks still hold it, so they can signal the destructor safely
+    struct Async_Tracker
+    {
+        std::atomic<std::uint32_t> outstanding{0};
+    };
+    //Held by the task of an async operation. If the executor destroys the task without running it,
+    //the guard abandons its async set so later writes do not wait for its place in the order, and signals the tracker
+    struct Async_Task_Guard
+    {
+        Async_Task_Guard(Synch_Value *IN_owner, std::shared_ptr<Async_Tracker> IN_tracker, bool IN_holds_set)
+        :   owner(IN_owner), tracker(std::move(IN_tracker)), holds_set(IN_holds_set) {}
+        ~Async_Task_Guard()
+        {
+            if(tracker)
+            {
+                if(holds_set)
+                {
+                    owner->apply_oldest_async_set(true);
+                }
+                finish();
+            }
+        }
+
+        Async_Task_Guard(Async_Task_Guard &&rhs) noexcept = default;
+        Async_Task_Guard& operator =(Async_Task_Guard &&rhs) = delete;
 
+        //Called by the task after it ran
+        void finish()
+        {
+            finish_async(*tracker);
+            tracker.reset();
+        }
+
+        Synch_Value *owner;
+        std::shared_ptr<Async_Tracker> tracker; //Empty once finished or moved from
+        bool holds_set;
+    };
+
+    template <typename U>
+    bool setInternal(U&& val, unsigned int orderIdx);
     template <typename U>
-    void fill_value_queue(U&& val);
+    bool store_value(U&& val); //Caller must be in write_in_order()
+    //Takes the places orderIdx to lastOrderIdx in the order. write returns false if it changed nothing
+    template <typename Write_Fn>
+    void write_in_order(Write_Fn&& write, unsigned int orderIdx, unsigned int lastOrderIdx);
+    void unsubscribe(std::uint64_t id);
+    void apply_oldest_async_set(bool abandon = false); //If abandon, only gives up the place of the set in the order
+    static void finish_async(Async_Tracker &tracker);
+    template <typename Modifier>
+    void modify_active(Modifier&& f);
+
     void fill_active_val_from_queue();
+    void apply_queued_modifiers(T& val, std::size_t pos); //Caller must hold activeValMut exclusively
+    void drop_oldest_queued(); //Caller must be in write_in_order()
 
-    std::queue<T> outstanding_input_vals;
+    Bounded_Queue<T> outstanding_input_vals{0};
+    Backpressure mBackpressure{Backpressure::Block};
     T active_val;
+    std::size_t next_active_pos{0}; //Queue position after the one in active_val. Guarded by activeValMut
+    std::size_t num_queued_vals{0}; //Values ever pushed to the queue, the last one is at num_queued_vals - 1. Only accessed in write_in_order()
+    std::vector<std::pair<std::size_t, std::move_only_function<void(T&)>>> queued_modifiers; //By queue position of their value. Guarded by activeValMut
+    Lock_Free_Cell_t<T> lockfree_val; //Holds the value instead of active_val in LOCKFREEREAD mode
     int mMode{0x0};
 
     std::atomic_uint setStartOrderIdx{1};
     std::atomic_uint setEndOrderIdx{0};
-    mutable Biased_Shared_Priority_Mutex activeValMut;
-    mutable std::mutex inputQueueMut;
+    //Bias of the runtime biased mutex: +1 with PRIORITIZESET (priority for setter), -1 with PRIORITIZEGET (priority for getter), 0 with both or none
+    static Mutex_T make_mutex(int mode);
+
+    mutable Mutex_T activeValMut;
     mutable std::mutex setAsyncOrderMut;
     mutable std::condition_variable setAsyncCond;
+
+    std::deque<Async_Set> pending_async_sets; //Ordered by firstOrderIdx. Guarded by asyncSetMut
+    mutable std::mutex asyncSetMut;
+    std::shared_ptr<Async_Tracker> async_tracker{std::make_shared<Async_Tracker>()};
+
+    std::atomic<std::uint64_t> mVersion{0};
+    std::vector<std::pair<std::uint64_t, std::function<void(std::uint64_t)>>> subscribers; //Guarded by subscriberMut
+    std::uint64_t next_subscriber_id{1}; //Guarded by subscriberMut
+    std::atomic<std::size_t> num_subscribers{0};
+    mutable std::shared_mutex subscriberMut;
 };
 
-template <typename T>
-Synch_Value<T>::Synch_Value(T&& initval, int mode)
-:   active_val(std::forward<T>(initval)),
+template <typename T, typename Mutex_T>
+Synch_Value<T, Mutex_T>::Synch_Value(T&& initval, int mode, std::size_t queue_capacity, Backpressure backpressure)
+:   outstanding_input_vals((mode & UPDATEINORDER) ? queue_capacity : 0),
+    mBackpressure(backpressure),
+    active_val(std::forward<T>(initval)),
     mMode(mode),
-    //Set the mode to either +1 (priority for setter) or -1 (priority for getter) or 0 if both or no flag is set in mode
-    activeValMut( (mode & SYNCHRONIZEDVALUEMODE::PRIORITIZESET / SYNCHRONIZEDVALUEMODE::PRIORITIZESET) - (mode & SYNCHRONIZEDVALUEMODE::PRIORITIZEGET / SYNCHRONIZEDVALUEMODE::PRIORITIZEGET) )
+    activeValMut(make_mutex(mode))
+{
+    assert(!((mode & UPDATEINORDER) && (mode & LOCKFREEREAD)) && "SynchronizedValue: LOCKFREEREAD cannot be combined with UPDATEINORDER");
+    if(mMode & LOCKFREEREAD)
+    {
+        lockfree_val.store(std::move(active_val));
+    }
+}
+
+template <typename T, typename Mutex_T>
+Synch_Value<T, Mutex_T>::~Synch_Value()
 {
+    for(std::uint32_t outstanding = async_tracker->outstanding.load(); outstanding != 0; outstanding = async_tracker->outstanding.load())
+    {
+        async_tracker->outstanding.wait(outstanding);
+    }
+}
 
+template <typename T, typename Mutex_T>
+Mutex_T Synch_Value<T, Mutex_T>::make_mutex(int mode)
+{
+    if constexpr(std::is_constructible_v<Mutex_T, int>)
+    {
+        return Mutex_T(((mode & SYNCHRONIZEDVALUEMODE::PRIORITIZESET) != 0) - ((mode & SYNCHRONIZEDVALUEMODE::PRIORITIZEGET) != 0));
+    }
+    else
+    {
+        return Mutex_T();
+    }
 }
 
-template <typename T> template <typename U>
-void Synch_Value<T>::setAsync(U&& val)
+template <typename T, typename Mutex_T> template <Free_Post_Executor Executor, typename U>
+void Synch_Value<T, Mutex_T>::setAsync(Executor& executor, U&& val)
 {
     static_assert(std::is_same<std::decay_t<U>,std::decay_t<T>>::value,
             "SynchronizedValue::setAsync: U must be the same as T");
 
-    std::async(std::launch::async, set(), std::forward<U> (val), setStartOrderIdx++);
+    {
+        std::lock_guard<std::mutex> lk(asyncSetMut);
+        const unsigned int orderIdx = setStartOrderIdx++;
+        //Nothing can have observed the queued value yet, and nothing else is ordered between it and this one
+        if(!(mMode & UPDATEINORDER) && !pending_async_sets.empty() && pending_async_sets.back().lastOrderIdx + 1 == orderIdx)
+        {
+            pending_async_sets.back().value = std::forward<U>(val);
+            pending_async_sets.back().lastOrderIdx = orderIdx;
+            return;
+        }
+        pending_async_sets.push_back(Async_Set{std::forward<U>(val), orderIdx, orderIdx});
+        async_tracker->outstanding++;
+    }
+    //Each task applies whichever set is oldest, so executors that do not run tasks in FIFO order cannot deadlock on the order
+    executor.post_free([this, guard=Async_Task_Guard(this, async_tracker, true)] () mutable
+    {
+        apply_oldest_async_set();
+        guard.finish();
+    });
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::apply_oldest_async_set(bool abandon)
+{
+    std::unique_lock<std::mutex> lk(asyncSetMut);
+    Async_Set asyncSet = std::move(pending_async_sets.front());
+    pending_async_sets.pop_front();
+    lk.unlock();
+
+    write_in_order([this, &asyncSet, abandon] () {return !abandon && store_value(std::move(asyncSet.value));}, asyncSet.firstOrderIdx, asyncSet.lastOrderIdx);
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::finish_async(Async_Tracker &tracker)
+{
+    tracker.outstanding--;
+    tracker.outstanding.notify_all();
 }
 
-template <typename T> template <typename U>
-void Synch_Value<T>::set(U&& val)
+template <typename T, typename Mutex_T> template <typename U>
+bool Synch_Value<T, Mutex_T>::set(U&& val)
 {
     static_assert(std::is_same<std::decay_t<U>,std::decay_t<T>>::value,
             "SynchronizedValue::set: U must be the same as T");
 
-    setInternal(std::forward<U>(val), setStartOrderIdx++);
+    return setInternal(std::forward<U>(val), setStartOrderIdx++);
 }
 
-template <typename T> template <typename U>
-void Synch_Value<T>::setInternal(U&& val, unsigned int orderIdx)
+template <typename T, typename Mutex_T> template <typename U>
+bool Synch_Value<T, Mutex_T>::setInternal(U&& val, unsigned int orderIdx)
 {
     static_assert(std::is_same<std::decay_t<U>,std::decay_t<T>>::value,
             "SynchronizedValue::setInternal: U must be the same as T");
-    assert(!(setEndOrderIdx != orderIdx+1 && setEndOrderIdx > orderIdx) && "SynchronizedValue::setInternal: setEndOrderIdx is out of order for attempted set call");
+
+    bool accepted = true;
+    write_in_order([this, &val, &accepted] () {return accepted = store_value(std::forward<U>(val));}, orderIdx, orderIdx);
+    return accepted;
+}
+
+template <typename T, typename Mutex_T> template <typename U>
+bool Synch_Value<T, Mutex_T>::store_value(U&& val)
+{
+    if(mMode & UPDATEINORDER)
+    {
+        if(mBackpressure == Backpressure::Drop_Oldest)
+        {
+            //Dropped here instead of in the queue, so that the modifications of a dropped value go with it
+            while(!outstanding_input_vals.try_push(std::forward<U>(val)))
+            {
+                drop_oldest_queued();
+            }
+        }
+        else if(!outstanding_input_vals.push(std::forward<U>(val), mBackpressure))
+        {
+            return false;
+        }
+        ++num_queued_vals;
+        return true;
+    }
+    else if(mMode & LOCKFREEREAD)
+    {
+        //Stores are serialized by setAsyncOrderMut
+        lockfree_val.store(std::forward<U>(val));
+    }
+    else
+    {
+        std::lock_guard<decltype(activeValMut)> lk(activeValMut);
+        active_val = std::forward<U>(val);
+    }
+    return true;
+}
+
+template <typename T, typename Mutex_T> template <typename Write_Fn>
+void Synch_Value<T, Mutex_T>::write_in_order(Write_Fn&& write, unsigned int orderIdx, unsigned int lastOrderIdx)
+{
+    assert(!(setEndOrderIdx != orderIdx+1 && setEndOrderIdx > orderIdx) && "SynchronizedValue::write_in_order: setEndOrderIdx is out of order for attempted set call");
 
     bool setComplete = false;
+    std::uint64_t newVersion = 0;
     do
     {
         std::unique_lock<std::mutex> lk(setAsyncOrderMut);
@@ -108,63 +410,236 @@ void Synch_Value<T>::setInternal(U&& val, unsigned int orderIdx)
         setAsyncCond.wait(lk, [this, orderIdx=orderIdx] () {return orderIdx == setEndOrderIdx + 1;});
         if(orderIdx == setEndOrderIdx + 1)
         {
-
-            if(mMode & UPDATEINORDER)
+            if(write())
             {
-                fill_value_queue(std::forward<U>(val));
+                newVersion = mVersion.fetch_add(1, std::memory_order_release) + 1;
+                mVersion.notify_all();
             }
-            else
-            {
-                std::lock_guard<decltype(activeValMut)> lk(activeValMut);
-                active_val = std::forward<U>(val);
-            }
-            setEndOrderIdx++;
+            setEndOrderIdx = lastOrderIdx;
             setComplete = true;
             setAsyncCond.notify_all();
         }
     } while(!setComplete);
+
+    //Outside of the order lock, so that slow callbacks do not hold up later sets
+    if(newVersion != 0 && num_subscribers.load(std::memory_order_acquire) != 0)
+    {
+        std::shared_lock<std::shared_mutex> lk(subscriberMut);
+        for(const auto &[id, callback] : subscribers)
+        {
+            callback(newVersion);
+        }
+    }
+}
+
+template <typename T, typename Mutex_T>
+std::uint64_t Synch_Value<T, Mutex_T>::wait_for_change(std::uint64_t last_seen_version) const
+{
+    mVersion.wait(last_seen_version, std::memory_order_acquire);
+    return mVersion.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Mutex_T>
+typename Synch_Value<T, Mutex_T>::Subscription Synch_Value<T, Mutex_T>::subscribe(std::function<void(std::uint64_t)> callback)
+{
+    std::lock_guard<std::shared_mutex> lk(subscriberMut);
+    const std::uint64_t id = next_subscriber_id++;
+    subscribers.emplace_back(id, std::move(callback));
+    num_subscribers.store(subscribers.size(), std::memory_order_release);
+    return Subscription(this, id);
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::unsubscribe(std::uint64_t id)
+{
+    std::lock_guard<std::shared_mutex> lk(subscriberMut);
+    std::erase_if(subscribers, [id] (const auto &subscriber) {return subscriber.first == id;});
+    num_subscribers.store(subscribers.size(), std::memory_order_release);
 }
 
-template <typename T>
-T Synch_Value<T>::get()
+template <typename T, typename Mutex_T>
+T Synch_Value<T, Mutex_T>::get()
 {
-    if((mMode & UPDATEINORDER) && !outstanding_input_vals.empty())
+    if(mMode & LOCKFREEREAD)
     {
-        fill_active_val_from_queue();
+        if constexpr(use_seqlock_v<T>)
+        {
+            return lockfree_val.load();
+        }
+        else
+        {
+            return *lockfree_val.load();
+        }
+    }
+    if(mMode & UPDATEINORDER)
+    {
+        std::size_t pos;
+        if(std::optional<T> val = outstanding_input_vals.try_pop(&pos))
+        {
+            {
+                std::lock_guard<decltype(activeValMut)> lk(activeValMut);
+                apply_queued_modifiers(*val, pos);
+                //A concurrent get() may have taken a later value already
+                if(pos >= next_active_pos)
+                {
+                    active_val = *val;
+                    next_active_pos = pos + 1;
+                }
+            }
+            return std::move(*val);
+        }
     }
     std::shared_lock<decltype(activeValMut)> readlock(activeValMut);
     return active_val;
 }
 
-template <typename T>
-std::future<T> Synch_Value<T>::getAsync()
+template <typename T, typename Mutex_T> template <Free_Post_Executor Executor>
+std::future<T> Synch_Value<T, Mutex_T>::getAsync(Executor& executor)
 {
-    return std::async(std::launch::async, get());
+    std::promise<T> promise;
+    std::future<T> result = promise.get_future();
+    async_tracker->outstanding++;
+    //A dropped task breaks the promise by itself
+    executor.post_free([this, guard=Async_Task_Guard(this, async_tracker, false), promise=std::move(promise)] () mutable
+    {
+        try
+        {
+            promise.set_value(get());
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+        guard.finish();
+    });
+    return result;
 }
 
-template <typename T> template <typename U>
-void Synch_Value<T>::fill_value_queue(U&& val)
+template <typename T, typename Mutex_T> template <typename Visitor>
+std::invoke_result_t<Visitor, const T&> Synch_Value<T, Mutex_T>::visit(Visitor&& f)
 {
-    static_assert(std::is_same<std::decay_t<U>,std::decay_t<T>>::value,
-            "SynchronizedValue::fill_value_queue: U must be the same as T");
+    if(mMode & LOCKFREEREAD)
     {
-        std::lock_guard<std::mutex> lk(inputQueueMut);
-        outstanding_input_vals.push(std::forward<U>(val));
+        if constexpr(use_seqlock_v<T>)
+        {
+            const T val = lockfree_val.load();
+            return std::invoke(std::forward<Visitor>(f), val);
+        }
+        else
+        {
+            const std::shared_ptr<const T> snapshot = lockfree_val.load();
+            return std::invoke(std::forward<Visitor>(f), *snapshot);
+        }
     }
+    if(mMode & UPDATEINORDER)
+    {
+        fill_active_val_from_queue();
+    }
+    std::shared_lock<decltype(activeValMut)> readlock(activeValMut);
+    return std::invoke(std::forward<Visitor>(f), std::as_const(active_val));
 }
 
-template <typename T>
-void Synch_Value<T>::fill_active_val_from_queue()
+template <typename T, typename Mutex_T>
+typename Synch_Value<T, Mutex_T>::Pinned_Value Synch_Value<T, Mutex_T>::pin()
 {
-    if(outstanding_input_vals.empty())
+    if(mMode & LOCKFREEREAD)
     {
+        if constexpr(use_seqlock_v<T>)
+        {
+            return Pinned_Value(std::in_place, lockfree_val.load());
+        }
+        else
+        {
+            return Pinned_Value(lockfree_val.load());
+        }
+    }
+    if(mMode & UPDATEINORDER)
+    {
+        fill_active_val_from_queue();
+    }
+    std::shared_lock<decltype(activeValMut)> readlock(activeValMut);
+    return Pinned_Value(std::move(readlock), active_val);
+}
+
+template <typename T, typename Mutex_T> template <typename Modifier>
+void Synch_Value<T, Mutex_T>::modify(Modifier&& f)
+{
+    const unsigned int orderIdx = setStartOrderIdx++;
+    write_in_order([this, &f] () {modify_active(std::forward<Modifier>(f)); return true;}, orderIdx, orderIdx);
+}
+
+template <typename T, typename Mutex_T> template <typename Modifier>
+void Synch_Value<T, Mutex_T>::modify_active(Modifier&& f)
+{
+    if(mMode & LOCKFREEREAD)
+    {
+        //Readers may hold the current version, so the change goes into a copy that is published as the next version
+        if constexpr(use_seqlock_v<T>)
+        {
+            T val = lockfree_val.load();
+            std::invoke(std::forward<Modifier>(f), val);
+            lockfree_val.store(val);
+        }
+        else
+        {
+            T val = *lockfree_val.load();
+            std::invoke(std::forward<Modifier>(f), val);
+            lockfree_val.store(std::move(val));
+        }
         return;
     }
-    std::lock_guard<std::mutex> lkq(inputQueueMut);
-    T &fillvalue = outstanding_input_vals.front();
     std::lock_guard<decltype(activeValMut)> lk(activeValMut);
-    active_val = fillvalue;
-    outstanding_input_vals.pop();
+    //Every value taken from the queue gets here under activeValMut, so the last one set is either active or will see the modifier
+    if((mMode & UPDATEINORDER) && next_active_pos != num_queued_vals)
+    {
+        queued_modifiers.emplace_back(num_queued_vals - 1, std::forward<Modifier>(f));
+        return;
+    }
+    std::invoke(std::forward<Modifier>(f), active_val);
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::fill_active_val_from_queue()
+{
+    std::size_t pos;
+    if(std::optional<T> val = outstanding_input_vals.try_pop(&pos))
+    {
+        std::lock_guard<decltype(activeValMut)> lk(activeValMut);
+        apply_queued_modifiers(*val, pos);
+        if(pos >= next_active_pos)
+        {
+            active_val = std::move(*val);
+            next_active_pos = pos + 1;
+        }
+    }
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::apply_queued_modifiers(T& val, std::size_t pos)
+{
+    if(queued_modifiers.empty())
+    {
+        return;
+    }
+    for(auto &[modifier_pos, modifier] : queued_modifiers)
+    {
+        if(modifier_pos == pos)
+        {
+            modifier(val);
+        }
+    }
+    std::erase_if(queued_modifiers, [pos] (const auto &modifier) {return modifier.first == pos;});
+}
+
+template <typename T, typename Mutex_T>
+void Synch_Value<T, Mutex_T>::drop_oldest_queued()
+{
+    std::size_t pos;
+    if(outstanding_input_vals.try_pop(&pos))
+    {
+        std::lock_guard<decltype(activeValMut)> lk(activeValMut);
+        std::erase_if(queued_modifiers, [pos] (const auto &modifier) {return modifier.first == pos;});
+    }
 }
 
 } //NS_concurrency
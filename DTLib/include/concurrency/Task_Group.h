@@ -0,0 +1,122 @@
+#ifndef TASK_GROUP_H
+#define TASK_GROUP_H
+
+#include <atomic>
+#include <DTools/concurrency/Thread_Pool.h>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Scope for a set of tasks posted to a shared Thread_Pool.
+ * wait() only waits for the tasks posted through this group, not for everything else running on the pool.
+ * Every task carries a token that counts the group down by one when the task is destroyed,
+ * i.e. right after it ran or when the pool discarded it. Completing a task therefore costs one atomic decrement;
+ * waiters are only notified when the count drops to zero.
+ * The destructor waits for all tasks of the group, so tasks may reference objects that outlive the group.
+ */
+class Task_Group final
+{
+public:
+    explicit Task_Group(Thread_Pool &pool) : m_pool(pool) {}
+    ~Task_Group() { wait(); }
+
+    Task_Group(const Task_Group &rhs) = delete;
+    Task_Group(Task_Group &&rhs) = delete;
+    Task_Group& operator=(const Task_Group &rhs) = delete;
+    Task_Group& operator=(Task_Group &&rhs) = delete;
+
+/*!
+ * \brief Post a function to the pool as part of this group, without getting a return future
+ * \param f: Functor
+ * \param args: Functor arguments
+ */
+template<typename Functor, typename... argtypes>
+    void post_free(Functor&& f, argtypes&&... args)
+    {
+        m_pool.post_free([token=Completion_Token(*this), f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+        {
+            std::invoke(std::move(f), std::move(args)...);
+        });
+    }
+
+/*!
+ * \brief Post a functor to the pool as part of this group.
+ * \param f: Functor
+ * \param args: Functor arguments
+ * \return Returns future with return value.
+ */
+template<typename Functor, typename... argtypes>
+[[nodiscard]] std::future< task_result_t<Functor, argtypes...> > post(Functor&& f, argtypes&&... args)
+    {
+        return m_pool.post([token=Completion_Token(*this), f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable
+        {
+            return std::invoke(std::move(f), std::move(args)...);
+        });
+    }
+
+/*!
+ * \brief Blocks until all tasks posted to this group are done
+ */
+void wait() const
+{
+    unsigned long long curr_tasks = m_outstanding_tasks.load(std::memory_order_acquire);
+    while(curr_tasks != 0)
+    {
+        m_outstanding_tasks.wait(curr_tasks, std::memory_order_acquire);
+        curr_tasks = m_outstanding_tasks.load(std::memory_order_acquire);
+    }
+}
+
+/*!
+ * \brief Non-blocking check whether all tasks posted to this group are done
+ */
+[[nodiscard]] bool done() const
+{
+    return m_outstanding_tasks.load(std::memory_order_acquire) == 0;
+}
+
+private:
+    //Counts the group up on creation and down on destruction, moves with the task
+    class Completion_Token
+    {
+    public:
+        explicit Completion_Token(Task_Group &group) : m_group(&group)
+        {
+            m_group->m_outstanding_tasks.fetch_add(1, std::memory_order_relaxed);
+        }
+        ~Completion_Token()
+        {
+            if(m_group != nullptr)
+            {
+                m_group->task_done();
+            }
+        }
+
+        Completion_Token(Completion_Token &&rhs) noexcept : m_group(std::exchange(rhs.m_group, nullptr)) {}
+        Completion_Token& operator=(Completion_Token &&rhs) = delete;
+        Completion_Token(const Completion_Token &rhs) = delete;
+        Completion_Token& operator=(const Completion_Token &rhs) = delete;
+    private:
+        Task_Group *m_group;
+    };
+
+    void task_done() noexcept
+    {
+        //Like std::latch, notify_all only uses the address, so a waiter may already destroy the group
+        if(m_outstanding_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_outstanding_tasks.notify_all();
+        }
+    }
+
+    Thread_Pool &m_pool;
+    std::atomic<unsigned long long> m_outstanding_tasks{0};
+};
+
+} //NS_concurrency
+} //NS_dtools
+#endif // TASK_GROUP_H
@@ -6,50 +6,944 @@ namespace NS_dtools
 namespace NS_concurrency
 {
 
-Thread_Pool::Thread_Pool(uint num_threads)
-    :m_pool(num_threads), m_thread_count(num_threads)
+namespace
 {
+//Pool and worker slot the current thread is running for, used to route nested posts to the local deque
+thread_local Thread_Pool *tl_current_pool = nullptr;
+thread_local std::size_t tl_worker_idx = 0;
+}
+
+Thread_Pool::Thread_Pool(uint num_threads) : Thread_Pool(num_threads, Placement_Config{}) {}
+
+Thread_Pool::Thread_Pool(uint num_threads, const Placement_Config &placement)
+{
+    if(!placement.numa_groups)
+    {
+        m_groups.push_back(std::make_unique<Worker_Group>(-1, placement.cpus));
+    }
+    else
+    {
+        const CPU_Topology topology = placement.topology ? *placement.topology : CPU_Topology::detect();
+        for(const CPU_Topology::Node &node : topology.nodes())
+        {
+            std::vector<int> group_cpus;
+            std::ranges::copy_if(node.cpus, std::back_inserter(group_cpus), [&placement](int cpu)
+            {
+                return placement.cpus.empty() || std::ranges::find(placement.cpus, cpu) != placement.cpus.end();
+            });
+            if(!group_cpus.empty())
+            {
+                m_groups.push_back(std::make_unique<Worker_Group>(node.id, std::move(group_cpus)));
+            }
+        }
+        if(m_groups.empty())
+        {
+            throw NS_dtools::NS_misc::OmegaException<std::vector<int>>("No NUMA node contains any of the placement CPUs: ", placement.cpus);
+        }
+    }
+
+    if(num_threads == 0)
+    {
+        //Tasks need a deque to wait in until a thread is attached
+        claim_worker_slot();
+        release_worker_slot(0);
+    }
+
+    attach_threads(num_threads);
 }
 
 Thread_Pool::~Thread_Pool()
 {
-    //Stop the threads; joining is implicit (with boost pool stop is also implicit)
+    //Stop the threads; outstanding tasks are discarded and the threads joined
     stop();
+    join();
 }
 
 void Thread_Pool::stop()
 {
-    m_pool.stop();
+    disable_auto_scaling();
+    m_stopped.store(true);
+    stop_timers();
+    wake_all_workers();
+    discard_queued_tasks();
 }
 
 void Thread_Pool::join()
 {
-    m_pool.join();
+    disable_auto_scaling();
+    m_joining.store(true);
+    //Pending timers are dropped, a periodic timer would keep the pool busy forever
+    stop_timers();
+    if(m_timer_thread.joinable())
+    {
+        m_timer_thread.join();
+    }
+    wake_all_workers();
+
+    //Retiring threads need m_worker_admin_mut on their way out, so they are joined outside of it
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+        const std::size_t worker_count = m_worker_count.load();
+        for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+        {
+            if(m_workers[worker_idx]->thread.joinable())
+            {
+                threads.push_back(std::move(m_workers[worker_idx]->thread));
+            }
+        }
+    }
+    for(std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    //Nothing will execute tasks anymore
+    m_stopped.store(true);
+}
+
+bool Thread_Pool::Timer_Handle::cancel()
+{
+    //A node that is gone cannot be pending anymore, the pool is not touched then
+    const Timer_Node_Ptr node = m_node.lock();
+    return node && m_pool->cancel_timer(node);
+}
+
+bool Thread_Pool::Timer_Handle::pending() const
+{
+    const Timer_Node_Ptr node = m_node.lock();
+    if(!node)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(m_pool->m_timer_mut);
+    return node->scheduled();
+}
+
+bool Thread_Pool::Task_Handle::cancel()
+{
+    if(!m_state)
+    {
+        return false;
+    }
+    m_state->stop_source.request_stop();
+    //Claims the task before a worker can start it, the worker then drops it on dequeue
+    Task_Status expected = Task_Status::Pending;
+    m_state->status.compare_exchange_strong(expected, Task_Status::Cancelled);
+    return expected != Task_Status::Running && expected != Task_Status::Finished && expected != Task_Status::Failed;
+}
+
+Thread_Pool::Task_Status Thread_Pool::Task_Handle::status() const
+{
+    return m_state ? m_state->status.load() : Task_Status::Discarded;
+}
+
+std::exception_ptr Thread_Pool::Task_Handle::exception() const
+{
+    return (m_state && m_state->status.load() == Task_Status::Failed) ? m_state->exception : nullptr;
+}
+
+std::stop_token Thread_Pool::Task_Handle::stop_token() const
+{
+    return m_state ? m_state->stop_source.get_token() : std::stop_token();
 }
 
 void Thread_Pool::wait_for_tasks_done() const
 {
-    std::unique_lock<std::mutex> lock(m_curr_task_update_mut);
-    m_tasks_done_cv.wait(lock, [this](){return m_current_tasks == 0;});
+    unsigned long long curr_tasks = m_current_tasks.load(std::memory_order_acquire);
+    while(curr_tasks != 0)
+    {
+        m_current_tasks.wait(curr_tasks, std::memory_order_acquire);
+        curr_tasks = m_current_tasks.load(std::memory_order_acquire);
+    }
 }
 
 void Thread_Pool::attach_current_thread()
 {
-    m_pool.attach();
+    std::size_t worker_idx = 0;
+    {
+        std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+        worker_idx = claim_worker_slot_locked();
+        m_workers[worker_idx]->group_idx.store(group_of_cpu(current_cpu()), std::memory_order_relaxed);
+    }
+    worker_loop(worker_idx, false);
+    release_worker_slot(worker_idx);
 }
 
 void Thread_Pool::attach_threads(uint num_threads)
 {
-    //Not currently supported
-    assert(false);
+    std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+    for(uint thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+    {
+        const std::size_t group_idx = least_loaded_group_locked();
+        const std::size_t worker_idx = claim_worker_slot_locked();
+        Worker &worker = *m_workers[worker_idx];
+        worker.group_idx.store(group_idx, std::memory_order_relaxed);
+        if(worker.thread.joinable())
+        {
+            //Retired thread that used this slot before. It is already past its loop
+            worker.thread.join();
+        }
+        worker.thread = std::thread([this, worker_idx, group_idx]()
+        {
+            const std::vector<int> &cpus = m_groups[group_idx]->cpus;
+            if(!cpus.empty())
+            {
+                pin_current_thread(cpus);
+            }
+            worker_loop(worker_idx, true);
+            release_worker_slot(worker_idx);
+        });
+        m_thread_count.fetch_add(1);
+    }
 }
 
 void Thread_Pool::detach_threads(uint num_threads)
 {
-    //Not currently supported
-    assert(false);
+    {
+        std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+        const uint num_retiring = std::min(num_threads, m_thread_count.load());
+        m_thread_count.fetch_sub(num_retiring);
+        m_retire_requests.fetch_add(num_retiring);
+    }
+    wake_all_workers();
 }
 
+uint Thread_Pool::thread_count() const
+{
+    return m_thread_count.load();
+}
+
+std::vector<int> Thread_Pool::numa_nodes() const
+{
+    std::vector<int> result;
+    for(const std::unique_ptr<Worker_Group> &group : m_groups)
+    {
+        if(group->node_id >= 0)
+        {
+            result.push_back(group->node_id);
+        }
+    }
+    return result;
+}
+
+int Thread_Pool::current_node()
+{
+    if(!tl_current_pool)
+    {
+        return -1;
+    }
+    const std::size_t group_idx = tl_current_pool->m_workers[tl_worker_idx]->group_idx.load(std::memory_order_relaxed);
+    return tl_current_pool->m_groups[group_idx]->node_id;
+}
+
+std::map<int, std::size_t> Thread_Pool::queue_depths() const
+{
+    std::map<int, std::size_t> result = m_priority_tasks.level_sizes();
+    std::size_t num_default_tasks = 0;
+    for(const std::unique_ptr<Worker_Group> &group : m_groups)
+    {
+        num_default_tasks += group->inbox.size();
+    }
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        num_default_tasks += m_workers[worker_idx]->queue.size() + m_workers[worker_idx]->inbox.size();
+    }
+    if(num_default_tasks != 0)
+    {
+        result[NS_priority_mutex::DEFAULT_PRIORITY] += num_default_tasks;
+    }
+    return result;
+}
+
+#ifdef DT_POOL_METRICS
+Thread_Pool::Metrics Thread_Pool::metrics() const
+{
+    Metrics result;
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    result.workers.reserve(worker_count);
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        const Worker &worker = *m_workers[worker_idx];
+        result.workers.push_back(Worker_Metrics{
+            worker.queue.size() + worker.inbox.size(),
+            m_groups[worker.group_idx.load(std::memory_order_relaxed)]->node_id,
+            worker.tasks_executed.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(worker.busy_ns.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(worker.idle_ns.load(std::memory_order_relaxed))});
+        result.queue_latency += worker.queue_latency.snapshot();
+        result.run_latency += worker.run_latency.snapshot();
+    }
+    result.priority_queue_depth = m_priority_tasks.size();
+    return result;
+}
+#endif
+
+void Thread_Pool::set_priority_aging_interval(std::chrono::steady_clock::duration aging_interval)
+{
+    m_priority_tasks.set_aging_interval(aging_interval);
+}
+
+void Thread_Pool::enable_auto_scaling(const Auto_Scaling_Config &config)
+{
+    if(config.min_threads > config.max_threads)
+    {
+        throw NS_dtools::NS_misc::OmegaException<uint>("Auto scaling: min_threads is larger than max_threads: ", config.min_threads);
+    }
+
+    std::lock_guard<std::mutex> lk(m_auto_scaling_mut);
+    m_auto_scaling_thread = std::jthread([this, config](std::stop_token stop_token)
+    {
+        auto_scaling_loop(stop_token, config);
+    });
+}
+
+void Thread_Pool::disable_auto_scaling()
+{
+    std::lock_guard<std::mutex> lk(m_auto_scaling_mut);
+    if(m_auto_scaling_thread.joinable())
+    {
+        m_auto_scaling_thread.request_stop();
+        m_auto_scaling_thread.join();
+    }
+}
+
+bool Thread_Pool::begin_enqueue(std::size_t num_tasks)
+{
+    if(m_current_tasks.fetch_add(num_tasks, std::memory_order_relaxed) >= std::numeric_limits<unsigned long long>::max() - num_tasks)
+    {
+        const unsigned long long curr_tasks = m_current_tasks.fetch_sub(num_tasks, std::memory_order_relaxed) - num_tasks;
+        throw NS_dtools::NS_misc::OmegaException<unsigned long long>("Task limit reached: ", curr_tasks);
+    }
+    //If the pool is stopped, the caller drops the tasks and counts them as done
+    return !m_stopped.load(std::memory_order_acquire);
+}
+
+void Thread_Pool::end_enqueue()
+{
+    //A stop() between begin_enqueue() and the push may have drained the queues before the tasks arrived.
+    //The queues are locked, so either that drain sees the tasks, or this check sees m_stopped
+    if(m_stopped.load(std::memory_order_acquire))
+    {
+        discard_queued_tasks();
+    }
+}
+
+void Thread_Pool::enqueue(Task &&task, int priority)
+{
+    if(!begin_enqueue(1))
+    {
+        //Nothing executes tasks anymore. Dropping the task breaks its promise, if any
+        task = nullptr;
+        task_done();
+        return;
+    }
+
+#ifdef DT_POOL_METRICS
+    task.set_enqueue_time(std::chrono::steady_clock::now());
+#endif
+    if(priority != NS_priority_mutex::DEFAULT_PRIORITY)
+    {
+        m_priority_tasks.push(priority, std::move(task));
+    }
+    else if(tl_current_pool == this)
+    {
+        m_workers[tl_worker_idx]->queue.push(std::move(task));
+    }
+    else
+    {
+        const std::size_t target_idx = m_next_worker.fetch_add(1, std::memory_order_relaxed)
+                                       % m_worker_count.load(std::memory_order_acquire);
+        m_workers[target_idx]->inbox.push(std::move(task));
+    }
+    end_enqueue();
+    wake_one_worker();
+}
+
+void Thread_Pool::enqueue_bulk(std::span<Task> tasks)
+{
+    if(tasks.empty())
+    {
+        return;
+    }
+
+    if(!begin_enqueue(tasks.size()))
+    {
+        for(Task &task : tasks)
+        {
+            task = nullptr;
+        }
+        task_done(tasks.size());
+        return;
+    }
+
+#ifdef DT_POOL_METRICS
+    const std::chrono::steady_clock::time_point enqueue_time = std::chrono::steady_clock::now();
+    for(Task &task : tasks)
+    {
+        task.set_enqueue_time(enqueue_time);
+    }
+#endif
+
+    if(tl_current_pool == this)
+    {
+        //Other workers will steal the oldest chunks from the front
+        m_workers[tl_worker_idx]->queue.push_bulk(tasks);
+    }
+    else
+    {
+        //Spread contiguous portions over the inboxes, one lock per inbox
+        const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+        const std::size_t first_worker = m_next_worker.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t portion_size = (tasks.size() + worker_count - 1) / worker_count;
+        for(std::size_t portion_idx = 0; portion_idx * portion_size < tasks.size(); ++portion_idx)
+        {
+            const std::size_t portion_begin = portion_idx * portion_size;
+            const std::size_t curr_portion_size = std::min(portion_size, tasks.size() - portion_begin);
+            m_workers[(first_worker + portion_idx) % worker_count]->inbox.push_bulk(tasks.subspan(portion_begin, curr_portion_size));
+        }
+    }
+    end_enqueue();
+    wake_workers(tasks.size());
+}
+
+void Thread_Pool::enqueue_on_node(int node, Task &&task)
+{
+    const auto group_it = std::ranges::find_if(m_groups, [node](const std::unique_ptr<Worker_Group> &group){ return group->node_id == node; });
+    if(node < 0 || group_it == m_groups.end())
+    {
+        enqueue(std::move(task));
+        return;
+    }
+
+    if(!begin_enqueue(1))
+    {
+        task = nullptr;
+        task_done();
+        return;
+    }
+
+#ifdef DT_POOL_METRICS
+    task.set_enqueue_time(std::chrono::steady_clock::now());
+#endif
+    const std::size_t group_idx = static_cast<std::size_t>(group_it - m_groups.begin());
+    if(tl_current_pool == this && m_workers[tl_worker_idx]->group_idx.load(std::memory_order_relaxed) == group_idx)
+    {
+        m_workers[tl_worker_idx]->queue.push(std::move(task));
+    }
+    else
+    {
+        (*group_it)->inbox.push(std::move(task));
+    }
+    end_enqueue();
+    wake_one_worker();
+}
+
+void Thread_Pool::task_done(unsigned long long num_tasks)
+{
+    const unsigned long long prev_tasks = m_current_tasks.fetch_sub(num_tasks, std::memory_order_acq_rel);
+    if(prev_tasks < num_tasks)
+    {
+        //This will crash the executable, but at this point we are fucked anyway
+        throw NS_dtools::NS_misc::BaseOmegaException("Internal Error: m_current_tasks is 0 at decrement!");
+    }
+
+    if(prev_tasks == num_tasks)
+    {
+        m_current_tasks.notify_all();
+        if(m_joining.load())
+        {
+            wake_all_workers();
+        }
+    }
+}
+
+std::size_t Thread_Pool::claim_worker_slot()
+{
+    std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+    return claim_worker_slot_locked();
+}
+
+std::size_t Thread_Pool::claim_worker_slot_locked()
+{
+    const std::size_t worker_count = m_worker_count.load();
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        if(!m_workers[worker_idx]->owned)
+        {
+            m_workers[worker_idx]->owned = true;
+            return worker_idx;
+        }
+    }
+
+    if(worker_count == MAX_WORKERS)
+    {
+        throw NS_dtools::NS_misc::OmegaException<std::size_t>("Worker limit reached: ", worker_count);
+    }
+    m_workers[worker_count] = std::make_unique<Worker>();
+    m_workers[worker_count]->owned = true;
+    //Publish the slot only after it is fully constructed
+    m_worker_count.store(worker_count + 1, std::memory_order_release);
+    return worker_count;
+}
+
+void Thread_Pool::release_worker_slot(std::size_t worker_idx)
+{
+    std::lock_guard<std::mutex> lk(m_worker_admin_mut);
+    m_workers[worker_idx]->owned = false;
+}
+
+std::size_t Thread_Pool::least_loaded_group_locked() const
+{
+    if(m_groups.size() == 1)
+    {
+        return 0;
+    }
+
+    std::vector<std::size_t> group_threads(m_groups.size(), 0);
+    const std::size_t worker_count = m_worker_count.load();
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        if(m_workers[worker_idx]->owned)
+        {
+            ++group_threads[m_workers[worker_idx]->group_idx.load(std::memory_order_relaxed)];
+        }
+    }
+    return static_cast<std::size_t>(std::ranges::min_element(group_threads) - group_threads.begin());
+}
+
+std::size_t Thread_Pool::group_of_cpu(int cpu) const
+{
+    for(std::size_t group_idx = 0; group_idx < m_groups.size(); ++group_idx)
+    {
+        if(std::ranges::find(m_groups[group_idx]->cpus, cpu) != m_groups[group_idx]->cpus.end())
+        {
+            return group_idx;
+        }
+    }
+    return 0;
+}
+
+void Thread_Pool::worker_loop(std::size_t worker_idx, bool may_retire)
+{
+    //Pools can be nested by attaching a worker of one pool to another
+    Thread_Pool *const prev_pool = tl_current_pool;
+    const std::size_t prev_worker_idx = tl_worker_idx;
+    tl_current_pool = this;
+    tl_worker_idx = worker_idx;
+
+    Task task;
+    unsigned int idle_rounds = 0;
+#ifdef DT_POOL_METRICS
+    Worker &worker = *m_workers[worker_idx];
+    std::chrono::steady_clock::time_point idle_since = std::chrono::steady_clock::now();
+#endif
+    while(!should_exit())
+    {
+        if(may_retire && try_retire())
+        {
+            break;
+        }
+
+        if(find_task(worker_idx, task))
+        {
+            idle_rounds = 0;
+#ifdef DT_POOL_METRICS
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            worker.idle_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(start - idle_since).count(), std::memory_order_relaxed);
+            worker.queue_latency.record(start - task.enqueue_time());
+#endif
+            task();
+            task = nullptr;
+#ifdef DT_POOL_METRICS
+            idle_since = std::chrono::steady_clock::now();
+            worker.run_latency.record(idle_since - start);
+            worker.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(idle_since - start).count(), std::memory_order_relaxed);
+            worker.tasks_executed.fetch_add(1, std::memory_order_relaxed);
+#endif
+            task_done();
+        }
+        else if(++idle_rounds < SPIN_ROUNDS_BEFORE_PARK)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            idle_rounds = 0;
+            if(!wait_for_work(may_retire))
+            {
+                break;
+            }
+        }
+    }
+
+#ifdef DT_POOL_METRICS
+    worker.idle_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - idle_since).count(), std::memory_order_relaxed);
+#endif
+
+    if(has_queued_tasks())
+    {
+        //Leftovers of a retired worker have to be stolen by the others
+        wake_all_workers();
+    }
+
+    tl_current_pool = prev_pool;
+    tl_worker_idx = prev_worker_idx;
+}
+
+bool Thread_Pool::try_retire()
+{
+    uint retire_requests = m_retire_requests.load(std::memory_order_relaxed);
+    while(retire_requests != 0)
+    {
+        if(m_retire_requests.compare_exchange_weak(retire_requests, retire_requests - 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Thread_Pool::find_task(std::size_t worker_idx, Task &OUT_task)
+{
+    //Prioritized (or aged) tasks overtake default priority work
+    if(m_priority_tasks.pop(OUT_task, NS_priority_mutex::DEFAULT_PRIORITY + 1))
+    {
+        return true;
+    }
+
+    Worker &worker = *m_workers[worker_idx];
+    const std::size_t group_idx = worker.group_idx.load(std::memory_order_relaxed);
+    if(worker.queue.pop(OUT_task) || worker.inbox.steal(OUT_task) || m_groups[group_idx]->inbox.steal(OUT_task))
+    {
+        return true;
+    }
+
+    //Stay on the own NUMA node as long as it has work
+    if(steal_task(worker_idx, true, OUT_task))
+    {
+        return true;
+    }
+    if(m_groups.size() > 1)
+    {
+        for(std::size_t offset = 1; offset < m_groups.size(); ++offset)
+        {
+            if(m_groups[(group_idx + offset) % m_groups.size()]->inbox.steal(OUT_task))
+            {
+                return true;
+            }
+        }
+        if(steal_task(worker_idx, false, OUT_task))
+        {
+            return true;
+        }
+    }
+
+    //Only low priority work left
+    return m_priority_tasks.pop(OUT_task);
+}
+
+bool Thread_Pool::steal_task(std::size_t worker_idx, bool same_group, Task &OUT_task)
+{
+    const std::size_t group_idx = m_workers[worker_idx]->group_idx.load(std::memory_order_relaxed);
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    for(std::size_t offset = 1; offset < worker_count; ++offset)
+    {
+        Worker &victim = *m_workers[(worker_idx + offset) % worker_count];
+        if(m_groups.size() > 1 && (victim.group_idx.load(std::memory_order_relaxed) == group_idx) != same_group)
+        {
+            continue;
+        }
+        if(victim.queue.steal(OUT_task) || victim.inbox.steal(OUT_task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t Thread_Pool::auto_grain(std::size_t range_size) const
+{
+    const std::size_t num_chunks = std::max<std::size_t>(1, m_worker_count.load(std::memory_order_acquire) * AUTO_CHUNKS_PER_WORKER);
+    return std::max<std::size_t>(1, range_size / num_chunks);
+}
+
+std::size_t Thread_Pool::queued_task_count() const
+{
+    std::size_t num_queued = m_priority_tasks.size();
+    for(const std::unique_ptr<Worker_Group> &group : m_groups)
+    {
+        num_queued += group->inbox.size();
+    }
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        num_queued += m_workers[worker_idx]->queue.size() + m_workers[worker_idx]->inbox.size();
+    }
+    return num_queued;
+}
+
+bool Thread_Pool::has_queued_tasks() const
+{
+    if(!m_priority_tasks.empty())
+    {
+        return true;
+    }
+    for(const std::unique_ptr<Worker_Group> &group : m_groups)
+    {
+        if(!group->inbox.empty())
+        {
+            return true;
+        }
+    }
+
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        if(!m_workers[worker_idx]->queue.empty() || !m_workers[worker_idx]->inbox.empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Thread_Pool::should_exit() const
+{
+    return m_stopped.load(std::memory_order_acquire)
+           || (m_joining.load(std::memory_order_acquire) && m_current_tasks.load(std::memory_order_acquire) == 0);
+}
+
+bool Thread_Pool::wait_for_work(bool may_retire)
+{
+    std::unique_lock<std::mutex> lk(m_idle_mut);
+    //Announce idling before the last check, so that enqueue() either sees us or we see its task
+    m_idle_workers.fetch_add(1);
+    m_idle_cv.wait(lk, [this, may_retire]()
+    {
+        return should_exit() || has_queued_tasks() || (may_retire && m_retire_requests.load() != 0);
+    });
+    m_idle_workers.fetch_sub(1);
+    return !should_exit();
+}
+
+void Thread_Pool::wake_one_worker()
+{
+    if(m_idle_workers.load() == 0)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_idle_mut);
+    }
+    m_idle_cv.notify_one();
+}
+
+void Thread_Pool::wake_workers(std::size_t num_tasks)
+{
+    if(num_tasks == 1)
+    {
+        wake_one_worker();
+    }
+    else if(m_idle_workers.load() != 0)
+    {
+        wake_all_workers();
+    }
+}
+
+void Thread_Pool::wake_all_workers()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_idle_mut);
+    }
+    m_idle_cv.notify_all();
+}
+
+void Thread_Pool::auto_scaling_loop(std::stop_token stop_token, Auto_Scaling_Config config)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::mutex sleep_mut;
+    std::condition_variable_any sleep_cv;
+    clock::time_point overloaded_since{};
+    clock::time_point idle_since{};
+    bool overloaded = false;
+    bool idle = false;
+
+    while(!stop_token.stop_requested())
+    {
+        const clock::time_point now = clock::now();
+        const uint num_threads = thread_count();
+        const std::size_t num_queued = queued_task_count();
+        const unsigned int num_idle = m_idle_workers.load();
+
+        if(num_threads < config.min_threads)
+        {
+            attach_threads(config.min_threads - num_threads);
+        }
+        else if(num_threads > config.max_threads)
+        {
+            detach_threads(num_threads - config.max_threads);
+        }
+        else
+        {
+            const bool now_overloaded = num_idle == 0 && num_queued > config.grow_queue_depth * std::max(1u, num_threads);
+            const bool now_idle = num_idle != 0 && num_queued == 0;
+            if(now_overloaded && !overloaded)
+            {
+                overloaded_since = now;
+            }
+            if(now_idle && !idle)
+            {
+                idle_since = now;
+            }
+            overloaded = now_overloaded;
+            idle = now_idle;
+
+            if(overloaded && num_threads < config.max_threads && now - overloaded_since >= config.grow_after)
+            {
+                attach_threads(1);
+                overloaded = false;
+            }
+            else if(idle && num_threads > config.min_threads && now - idle_since >= config.shrink_after)
+            {
+                detach_threads(1);
+                idle = false;
+            }
+        }
+
+        std::unique_lock<std::mutex> lk(sleep_mut);
+        sleep_cv.wait_for(lk, stop_token, config.check_interval, [](){ return false; });
+    }
+}
+
+void Thread_Pool::discard_queued_tasks()
+{
+    const std::size_t num_prioritized_discarded = m_priority_tasks.clear();
+    if(num_prioritized_discarded != 0)
+    {
+        task_done(num_prioritized_discarded);
+    }
+
+    for(const std::unique_ptr<Worker_Group> &group : m_groups)
+    {
+        const std::size_t num_discarded = group->inbox.clear();
+        if(num_discarded != 0)
+        {
+            task_done(num_discarded);
+        }
+    }
+
+    const std::size_t worker_count = m_worker_count.load(std::memory_order_acquire);
+    for(std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        const std::size_t num_discarded = m_workers[worker_idx]->queue.clear() + m_workers[worker_idx]->inbox.clear();
+        if(num_discarded != 0)
+        {
+            task_done(num_discarded);
+        }
+    }
+}
+
+Thread_Pool::Timer_Handle Thread_Pool::add_timer(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration period, Task &&task)
+{
+    std::lock_guard<std::mutex> lk(m_timer_mut);
+    if(m_stopped.load() || m_joining.load())
+    {
+        //Dropping the task breaks its promise, if any
+        task = nullptr;
+        return Timer_Handle();
+    }
+
+    if(!m_timer_thread.joinable())
+    {
+        m_timer_thread = std::jthread([this](std::stop_token stop_token){ timer_loop(stop_token); });
+    }
+    Timer_Node_Ptr node = m_timers.insert(deadline, Timer_Task{std::move(task), period});
+    if(deadline < m_timer_wakeup)
+    {
+        m_timer_rescan = true;
+        m_timer_cv.notify_one();
+    }
+    return Timer_Handle(*this, node);
+}
+
+bool Thread_Pool::cancel_timer(const Timer_Node_Ptr &node)
+{
+    std::lock_guard<std::mutex> lk(m_timer_mut);
+    return m_timers.erase(node);
+}
+
+void Thread_Pool::timer_loop(std::stop_token stop_token)
+{
+    std::vector<Timer_Node_Ptr> expired;
+    std::vector<Task> due_tasks;
+    std::unique_lock<std::mutex> lk(m_timer_mut);
+    while(!stop_token.stop_requested())
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        m_timers.advance(now, expired);
+        for(Timer_Node_Ptr &node : expired)
+        {
+            Timer_Task &timer = node->element;
+            if(timer.period == std::chrono::steady_clock::duration::zero())
+            {
+                due_tasks.push_back(std::move(timer.task));
+                continue;
+            }
+
+            //Stay on the grid of the first deadline, occurrences that already passed are skipped
+            const std::chrono::steady_clock::duration overdue = now - node->deadline();
+            m_timers.reschedule(node, node->deadline() + (overdue / timer.period + 1) * timer.period);
+            if(!timer.in_flight)
+            {
+                timer.in_flight = true;
+                due_tasks.push_back([this, node]()
+                {
+                    node->element.task();
+                    std::lock_guard<std::mutex> in_flight_lk(m_timer_mut);
+                    node->element.in_flight = false;
+                });
+            }
+        }
+        expired.clear();
+
+        if(!due_tasks.empty())
+        {
+            lk.unlock();
+            for(Task &task : due_tasks)
+            {
+                enqueue(std::move(task));
+            }
+            due_tasks.clear();
+            lk.lock();
+            continue;
+        }
+
+        m_timer_rescan = false;
+        const std::optional<std::chrono::steady_clock::time_point> wakeup = m_timers.next_wakeup();
+        m_timer_wakeup = wakeup.value_or(std::chrono::steady_clock::time_point::max());
+        if(wakeup)
+        {
+            m_timer_cv.wait_until(lk, stop_token, *wakeup, [this](){ return m_timer_rescan; });
+        }
+        else
+        {
+            m_timer_cv.wait(lk, stop_token, [this](){ return m_timer_rescan; });
+        }
+    }
+}
+
+void Thread_Pool::stop_timers()
+{
+    std::vector<Timer_Node_Ptr> discarded;
+    {
+        std::lock_guard<std::mutex> lk(m_timer_mut);
+        m_timers.clear(discarded);
+        m_timer_thread.request_stop();
+    }
+    //Tasks are destroyed outside of the lock
+}
 
 } //NS_concurrency
 } //NS_dtools
@@ -1,8 +1,33 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
-#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
 #include <DTools/MiscTools.h>
+#include <DTools/concurrency/CPU_Topology.h>
+#include <DTools/concurrency/Pool_Task.h>
+#ifdef DT_POOL_METRICS
+#include <DTools/concurrency/Latency_Histogram.h>
+#endif
+#include <DTools/concurrency/PriorityMutex.h>
+#include <DTools/concurrency/Priority_Task_Queue.h>
+#include <DTools/concurrency/Timer_Wheel.h>
+#include <DTools/concurrency/Work_Stealing_Queue.h>
 
 namespace NS_dtools
 {
@@ -17,19 +42,84 @@ namespace NS_concurrency
  * -Should have a function like "wait-for-all-tasks-to-be-done"
  * -Should be able to attach a thread from within the thread (and also detach it from within the thread?)
  *
- *-Should use the std::jthread class and also join on destruction, if not using boost thread_pool
+ * The pool uses its own work-stealing scheduler:
+ * Every worker owns a deque. Tasks posted from within a task go to the back of the local deque and
+ * are popped LIFO by their owner. Tasks posted from outside the pool are spread round-robin over the
+ * workers' inboxes, which are always taken FIFO. A worker without local work takes from its inbox and
+ * then steals FIFO from the other deques and inboxes before it parks.
+ * The only pool-wide state touched per task is the atomic m_current_tasks counter,
+ * waiters of wait_for_tasks_done() are only notified when it drops to zero.
  *
- *TODO: I suppose in the long run, I should re-implement this from scratch. The boost thread pool is too limiting in its API
- *Perhaps there IS no way to implement a wait_for_empty_task_queue, that does not destroy the performance?
- *Because in the end, I have to SOMEHOW get the shared state of the whole pool.
- *Is this usecase (waiting for current tasks without completely joining pool) even sensible?
- *Or is that soemthing that should be handled using barriers instead?
+ * The number of pool threads can be changed at runtime with attach_threads() / detach_threads(),
+ * or automatically by a supervisor thread, see enable_auto_scaling().
+ *
+ * Tasks can be posted with a priority (default NS_priority_mutex::DEFAULT_PRIORITY = 100, higher runs first).
+ * Default priority tasks use the work-stealing deques, all other tasks go through one shared multi-level queue
+ * with aging. Workers take tasks whose (aged) priority exceeds the default before their own deque,
+ * and lower priority tasks once no default priority work is left.
+ *
+ * Coroutines can move themselves onto the pool with co_await pool.schedule(), see Lazy_Task.h.
+ *
+ * post_after(), post_at() and post_every() keep their tasks in a timer wheel until they are due.
+ * A single timer thread, started with the first timer, advances the wheel and posts the due tasks.
+ *
+ * Building with DT_POOL_METRICS enables metrics(): per-worker counters and latency histograms,
+ * recorded by each worker into its own atomics and read without locking. Without the define nothing is recorded or stored.
+ *
+ * Workers can be pinned to a CPU set and split into one group per NUMA node, see Placement_Config.
+ * Every group has an inbox of its own for post_on_node(), and its workers steal within the group
+ * before they turn to other groups.
+ *
+ * post_cancellable() returns a Task_Handle. Tasks cancelled through it or an external std::stop_token,
+ * and tasks whose deadline passed, stay queued but are dropped without running when they are dequeued.
+ *
+ * Tasks are stored as Pool_Task, so a functor with its arguments of up to 64 bytes is queued without allocation.
+ * Like std::thread, the functor and its arguments are decay-copied into the task and moved into the call,
+ * so move-only functors, arguments and return types are supported.
  * */
 
+template<typename Functor, typename... argtypes>
+using task_result_t = std::invoke_result_t<std::decay_t<Functor>, std::decay_t<argtypes>...>;
+
 class Thread_Pool final
 {
+    struct Timer_Task; //Element of the timer wheel, defined below
+    struct Cancel_State; //Shared by a cancellable task and its handles, defined below
+
 public:
+    /*!
+     * \brief Bounds and thresholds for enable_auto_scaling().
+     * The pool grows by one thread when there were more than grow_queue_depth queued tasks per thread
+     * and no idle worker for at least grow_after. It shrinks by one thread when at least one worker
+     * was idle for shrink_after. Both conditions have to be met without interruption (hysteresis).
+     */
+    struct Auto_Scaling_Config
+    {
+        uint min_threads{1};
+        uint max_threads{std::max(1u, std::thread::hardware_concurrency())};
+        std::size_t grow_queue_depth{4};
+        std::chrono::milliseconds grow_after{20};
+        std::chrono::milliseconds shrink_after{1000};
+        std::chrono::milliseconds check_interval{5};
+    };
+
+    /*!
+     * \brief Where the pool threads run.
+     * Without numa_groups all workers form one group that is restricted to cpus.
+     * With numa_groups the workers are spread evenly over the NUMA nodes that have CPUs in cpus (all nodes, if cpus is empty).
+     * Every group is pinned to the CPUs of its node and has its own inbox for post_on_node().
+     * Pinning is best effort: if the system rejects a CPU set, the thread runs unpinned.
+     * Threads added with attach_current_thread() are never pinned, they join the group of the CPU they run on.
+     */
+    struct Placement_Config
+    {
+        std::vector<int> cpus; //Pool threads only run on these CPUs. Empty for no restriction
+        bool numa_groups{false};
+        std::optional<CPU_Topology> topology; //Detected from /sys/devices/system if empty
+    };
+
     Thread_Pool(uint num_threads);
+    Thread_Pool(uint num_threads, const Placement_Config &placement);
     ~Thread_Pool();
 
     Thread_Pool(const Thread_Pool &rhs) = delete;
@@ -45,120 +135,733 @@ public:
  * \param args: Functor arguments
  */
 template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
     void post_free(Functor&& f, argtypes&&... args)
     {
-        std::lock_guard<std::mutex> guard(m_curr_task_update_mut);
-        if(not (m_current_tasks < std::numeric_limits<unsigned long long>::max() - 1) )
-        {
-            throw NS_dtools::NS_misc::OmegaException<unsigned long long>("Task limit reached: ", m_current_tasks);
-        }
-        ++m_current_tasks;
+        post_free(NS_priority_mutex::DEFAULT_PRIORITY, std::forward<Functor>(f), std::forward<argtypes>(args)...);
+    }
 
-        auto bound_functor = std::bind(std::forward<Functor>(f), std::forward<argtypes>(args)...);
-        auto task_wrapper = [this, bound_functor=std::move(bound_functor)]() -> void
+/*!
+ * \brief Post a function with the given priority to the pool without getting a return future
+ * \param priority: Higher values are executed first
+ * \param f: Functor
+ * \param args: Functor arguments
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+    void post_free(int priority, Functor&& f, argtypes&&... args)
+    {
+        enqueue([f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
         {
-            bound_functor();
-            std::lock_guard<std::mutex> guard(m_curr_task_update_mut);
+            std::invoke(std::move(f), std::move(args)...);
+        }, priority);
+    }
 
-            if(m_current_tasks == 0)
-            {
-                throw NS_dtools::NS_misc::BaseOmegaException("Internal Error: m_current_tasks is 0 at decrement!");
-            }
+/*!
+ * \brief Post an already type-erased task without wrapping it again
+ * \param task: Task to execute, dropped without running if the pool is stopped
+ * \param priority: Higher values are executed first
+ */
+void post_task(Pool_Task &&task, int priority = NS_priority_mutex::DEFAULT_PRIORITY)
+{
+    enqueue(std::move(task), priority);
+}
 
-            --m_current_tasks;
-            m_tasks_done_cv.notify_all();
-        };
+/*!
+ * \brief Post a functor to the pool.
+ *  Synchronizes-with the thread starting the task.
+ *  All sequential operations before the post() have a happens-before relationship with the posted task.
+ * \param f: Functor
+ * \param args: Functor arguments
+ * \return Returns future with return value.
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+[[nodiscard]] std::future< task_result_t<Functor, argtypes...> > post(Functor&& f, argtypes&&... args)
+    {
+        return post(NS_priority_mutex::DEFAULT_PRIORITY, std::forward<Functor>(f), std::forward<argtypes>(args)...);
+    }
 
+/*!
+ * \brief Post a functor with the given priority to the pool.
+ * \param priority: Higher values are executed first
+ * \param f: Functor
+ * \param args: Functor arguments
+ * \return Returns future with return value.
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+[[nodiscard]] std::future< task_result_t<Functor, argtypes...> > post(int priority, Functor&& f, argtypes&&... args)
+    {
+        std::promise<task_result_t<Functor, argtypes...>> promise;
+        auto result_future = promise.get_future();
 
-        boost::asio::post(m_pool, task_wrapper );
+        enqueue([promise=std::move(promise), f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+        {
+            fulfill_promise(promise, std::move(f), std::move(args)...);
+        }, priority);
+        return result_future;
     }
 
 /*!
- * \brief Post a functor to the pool.
- *  Synchronizes-with the thread starting the task.
- *  All sequential operations before the post() have a happens-before relationship with the posted task.
+ * \brief Post a functor to the worker group of a NUMA node, so it runs close to memory allocated there.
+ *  Only a hint: idle workers of other groups still steal the task.
+ *  Posted from a worker of the same group, the task goes to that worker's own deque.
+ *  If the pool is not split by NUMA node, or has no group for node, the task is posted like with post().
+ * \param node: NUMA node id, see numa_nodes()
  * \param f: Functor
  * \param args: Functor arguments
  * \return Returns future with return value.
  */
 template<typename Functor, typename... argtypes>
-[[nodiscard]] std::future< std::invoke_result_t<Functor, argtypes...> > post(Functor&& f, argtypes&&... args)
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+[[nodiscard]] std::future< task_result_t<Functor, argtypes...> > post_on_node(int node, Functor&& f, argtypes&&... args)
     {
-        std::lock_guard<std::mutex> guard(m_curr_task_update_mut);
-        if(not (m_current_tasks < std::numeric_limits<unsigned long long>::max() - 1) )
+        std::promise<task_result_t<Functor, argtypes...>> promise;
+        auto result_future = promise.get_future();
+
+        enqueue_on_node(node, [promise=std::move(promise), f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
         {
-            throw NS_dtools::NS_misc::OmegaException<unsigned long long>("Task limit reached: ", m_current_tasks);
-        }
-        ++m_current_tasks;
+            fulfill_promise(promise, std::move(f), std::move(args)...);
+        });
+        return result_future;
+    }
+
+/*!
+ * \brief Awaitable that resumes the awaiting coroutine on a pool worker.
+ * The resumption is queued like any other task, without allocating.
+ * If the pool discards the task (stop()), the coroutine is never resumed.
+ */
+class Schedule_Awaiter
+{
+public:
+    Schedule_Awaiter(Thread_Pool &pool, int priority) : m_pool(pool), m_priority(priority) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_pool.enqueue([handle](){ handle.resume(); }, m_priority);
+    }
+    void await_resume() const noexcept {}
 
+private:
+    Thread_Pool &m_pool;
+    int m_priority;
+};
+
+/*!
+ * \brief co_await pool.schedule() continues the calling coroutine on a pool worker.
+ * \param priority: Priority of the resumption, see post()
+ */
+[[nodiscard]] Schedule_Awaiter schedule(int priority = NS_priority_mutex::DEFAULT_PRIORITY)
+{
+    return Schedule_Awaiter(*this, priority);
+}
+
+/*!
+ * \brief Refers to a task posted with post_after(), post_at() or post_every().
+ * Copyable. A default constructed handle refers to no timer.
+ */
+class Timer_Handle
+{
+public:
+    Timer_Handle() = default;
+
+    /*!
+     * \brief Removes the timer from the pool in O(1).
+     * A periodic task is not posted again, a run that already started is not interrupted.
+     * \return False if the timer was not pending anymore, i.e. it was already posted, cancelled or discarded.
+     */
+    bool cancel();
+
+    [[nodiscard]] bool pending() const; //non-blocking, may be outdated right away
+
+private:
+    friend class Thread_Pool;
+    Timer_Handle(Thread_Pool &pool, std::weak_ptr<Timer_Wheel<Timer_Task>::Node> node) : m_pool(&pool), m_node(std::move(node)) {}
+
+    Thread_Pool *m_pool{nullptr};
+    std::weak_ptr<Timer_Wheel<Timer_Task>::Node> m_node;
+};
+
+/*!
+ * \brief Post a function to the pool once delay has passed.
+ * The task is posted no earlier than after delay and at most one timer tick (1ms) later.
+ * \param delay: Time until the task is posted
+ * \param f: Functor
+ * \param args: Functor arguments
+ * \return Handle to cancel the task before it is posted
+ */
+template<typename Rep, typename Period, typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+    Timer_Handle post_after(std::chrono::duration<Rep, Period> delay, Functor&& f, argtypes&&... args)
+    {
+        return post_at(std::chrono::steady_clock::now() + delay, std::forward<Functor>(f), std::forward<argtypes>(args)...);
+    }
 
-        auto bound_functor = std::bind(std::forward<Functor>(f), std::forward<argtypes>(args)...);
-        auto task_wrapper = [this, bound_functor=std::move(bound_functor)]() -> std::invoke_result_t<Functor, argtypes...>
+/*!
+ * \brief Post a function to the pool at the given time.
+ * Time points of other clocks than std::chrono::steady_clock are converted once, so later clock adjustments are ignored.
+ * \param time: Earliest time at which the task is posted
+ * \param f: Functor
+ * \param args: Functor arguments
+ * \return Handle to cancel the task before it is posted
+ */
+template<typename Clock, typename Duration, typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+    Timer_Handle post_at(std::chrono::time_point<Clock, Duration> time, Functor&& f, argtypes&&... args)
+    {
+        std::chrono::steady_clock::time_point deadline;
+        if constexpr(std::is_same_v<Clock, std::chrono::steady_clock>)
+        {
+            deadline = std::chrono::time_point_cast<std::chrono::steady_clock::duration>(time);
+        }
+        else
         {
-            const std::invoke_result_t<Functor, argtypes...> result = bound_functor();
-            std::lock_guard<std::mutex> guard(m_curr_task_update_mut);
+            deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time - Clock::now());
+        }
+        return add_timer(deadline, std::chrono::steady_clock::duration::zero(),
+                         [f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+        {
+            std::invoke(std::move(f), std::move(args)...);
+        });
+    }
+
+/*!
+ * \brief Post a function to the pool every period, the first time after one period.
+ * Runs of the same timer never overlap: if a run is still going when the next one is due, that occurrence is skipped.
+ * The schedule does not drift, occurrences stay on multiples of period.
+ * \param period: Interval between two posts, must be positive
+ * \param f: Functor, called with lvalue references to the stored arguments
+ * \param args: Functor arguments
+ * \return Handle to stop the timer
+ */
+template<typename Rep, typename Period, typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>&, std::decay_t<argtypes>&...>
+    Timer_Handle post_every(std::chrono::duration<Rep, Period> period, Functor&& f, argtypes&&... args)
+    {
+        const auto steady_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        if(steady_period <= std::chrono::steady_clock::duration::zero())
+        {
+            throw NS_dtools::NS_misc::OmegaException<std::chrono::steady_clock::rep>("Timer period must be positive: ", steady_period.count());
+        }
+        return add_timer(std::chrono::steady_clock::now() + steady_period, steady_period,
+                         [f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+        {
+            std::invoke(f, args...);
+        });
+    }
+
+/*!
+ * \brief Lifecycle of a task posted with post_cancellable()
+ */
+enum class Task_Status
+{
+    Pending,   //Queued, not started yet
+    Running,
+    Finished,  //Ran to completion
+    Failed,    //Threw, see Task_Handle::exception()
+    Cancelled, //Dropped without running because stop was requested before it started
+    Expired,   //Dropped without running because its deadline passed before it started
+    Discarded  //Dropped without running by stop()
+};
 
-            if(m_current_tasks == 0)
+/*!
+ * \brief Options for post_cancellable()
+ */
+struct Task_Options
+{
+    int priority{NS_priority_mutex::DEFAULT_PRIORITY};
+    std::stop_token stop_token; //Stop requests on this token also cancel the task
+    std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()}; //The task is dropped if it has not started by then
+};
+
+/*!
+ * \brief Refers to a task posted with post_cancellable(). Copyable.
+ */
+class Task_Handle
+{
+public:
+    Task_Handle() = default;
+
+    /*!
+     * \brief Requests stop on the task's stop token.
+     * A task that has not started yet is dropped when it is dequeued, a running task only sees the stop request.
+     * \return True if the task will not run
+     */
+    bool cancel();
+
+    [[nodiscard]] Task_Status status() const;
+    [[nodiscard]] std::stop_token stop_token() const;
+    [[nodiscard]] std::exception_ptr exception() const; //Exception thrown by the task if its status is Failed, else nullptr
+
+private:
+    friend class Thread_Pool;
+    explicit Task_Handle(std::shared_ptr<Cancel_State> state) : m_state(std::move(state)) {}
+
+    std::shared_ptr<Cancel_State> m_state;
+};
+
+/*!
+ * \brief Post a function that can be cancelled until it starts.
+ * Cancelled and expired tasks stay queued, but are dropped without running when a worker dequeues them.
+ * \param options: Priority, external stop token and deadline of the task
+ * \param f: Functor. If it accepts a std::stop_token as first argument, it gets the task's token for cooperative cancellation while running.
+ * \param args: Functor arguments
+ * \return Handle to cancel the task and query its status
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+          || std::invocable<std::decay_t<Functor>, std::stop_token, std::decay_t<argtypes>...>
+    Task_Handle post_cancellable(const Task_Options &options, Functor&& f, argtypes&&... args)
+    {
+        auto state = std::make_shared<Cancel_State>(options.stop_token);
+        enqueue([guard=Discard_Guard(state), deadline=options.deadline, f=std::forward<Functor>(f), ...args=std::forward<argtypes>(args)]() mutable -> void
+        {
+            Cancel_State &curr_state = *guard.state;
+            if(!curr_state.try_start(deadline))
+            {
+                return;
+            }
+            try
+            {
+                if constexpr(std::invocable<std::decay_t<Functor>, std::stop_token, std::decay_t<argtypes>...>)
+                {
+                    std::invoke(std::move(f), curr_state.stop_source.get_token(), std::move(args)...);
+                }
+                else
+                {
+                    std::invoke(std::move(f), std::move(args)...);
+                }
+            }
+            catch(...)
             {
-                //This will crash the executable, but at this point we are fucked anyway
-                throw NS_dtools::NS_misc::BaseOmegaException("Internal Error: m_current_tasks is 0 at decrement!");
+                //There is no future to carry it, and it must not unwind the worker
+                curr_state.exception = std::current_exception();
+                curr_state.status.store(Task_Status::Failed);
+                return;
             }
+            curr_state.status.store(Task_Status::Finished);
+        }, options.priority);
+        return Task_Handle(std::move(state));
+    }
+
+/*!
+ * \brief Post a function with default options that can be cancelled until it starts, see above
+ */
+template<typename Functor, typename... argtypes>
+    requires std::invocable<std::decay_t<Functor>, std::decay_t<argtypes>...>
+          || std::invocable<std::decay_t<Functor>, std::stop_token, std::decay_t<argtypes>...>
+    Task_Handle post_cancellable(Functor&& f, argtypes&&... args)
+    {
+        return post_cancellable(Task_Options{}, std::forward<Functor>(f), std::forward<argtypes>(args)...);
+    }
 
-            --m_current_tasks;
-            m_tasks_done_cv.notify_all();
+/*!
+ * \brief Calls f(i) for every i in [begin, end) on the pool.
+ *  The range is split into chunks of grain indices that are submitted in one go,
+ *  so the pool-wide bookkeeping is done once per call instead of once per index.
+ *  f is shared by all chunks and may be called concurrently.
+ * \param begin: First index
+ * \param end: One past the last index
+ * \param grain: Indices per chunk. 0 chooses a chunk size based on the number of workers
+ * \param f: Functor taking an index
+ * \return One future for the whole range. Holds the first exception thrown by f, if any.
+ *  After an exception, chunks that have not started yet are skipped.
+ */
+template<std::integral Index_t, typename Functor>
+[[nodiscard]] std::future<void> parallel_for(Index_t begin, Index_t end, Index_t grain, Functor&& f)
+    {
+        if(grain < 0)
+        {
+            throw NS_dtools::NS_misc::OmegaException<Index_t>("parallel_for: grain must not be negative: ", grain);
+        }
 
-            return result;
-        };
+        const std::size_t range_size = end > begin ? static_cast<std::size_t>(end - begin) : 0;
+        const std::size_t chunk_size = grain == 0 ? auto_grain(range_size) : static_cast<std::size_t>(grain);
+        const std::size_t num_chunks = (range_size + chunk_size - 1) / chunk_size;
 
+        auto state = std::make_shared<Bulk_State<std::decay_t<Functor>>>(num_chunks, std::forward<Functor>(f));
+        auto result_future = state->promise.get_future();
+        if(num_chunks == 0)
+        {
+            state->promise.set_value();
+            return result_future;
+        }
 
-        return boost::asio::post(m_pool,
-                                 std::packaged_task<std::invoke_result_t<Functor, argtypes...>()>(task_wrapper) );
+        std::vector<Task> chunk_tasks;
+        chunk_tasks.reserve(num_chunks);
+        for(std::size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+        {
+            const Index_t chunk_begin = static_cast<Index_t>(begin + chunk_idx * chunk_size);
+            const Index_t chunk_end = static_cast<Index_t>(begin + std::min(range_size, (chunk_idx + 1) * chunk_size));
+            chunk_tasks.emplace_back([state, chunk_begin, chunk_end]()
+            {
+                state->run_chunk([&state, chunk_begin, chunk_end]()
+                {
+                    for(Index_t idx = chunk_begin; idx < chunk_end; ++idx)
+                    {
+                        std::invoke(state->functor, idx);
+                    }
+                });
+            });
+        }
+        enqueue_bulk(chunk_tasks);
+        return result_future;
+    }
+
+/*!
+ * \brief Calls f(element) for every element of range on the pool. See parallel_for().
+ *  The range is accessed by reference and must stay alive until the returned future is ready.
+ * \param range: Random access range
+ * \param f: Functor taking a reference to an element
+ * \param grain: Elements per chunk. 0 chooses a chunk size based on the number of workers
+ * \return One future for the whole range
+ */
+template<std::ranges::random_access_range Range, typename Functor>
+[[nodiscard]] std::future<void> post_bulk(Range &range, Functor&& f, std::size_t grain = 0)
+    {
+        auto first = std::ranges::begin(range);
+        const auto range_size = static_cast<std::size_t>(std::ranges::distance(range));
+        return parallel_for<std::size_t>(0, range_size, grain, [first, f=std::forward<Functor>(f)](std::size_t idx)
+        {
+            std::invoke(f, first[idx]);
+        });
     }
 
 /*!
  * \brief Stop execution of thread pool.
- * Does not join immediately.
+ * Tasks that have not started yet are discarded. Does not join immediately.
  */
 void stop();
 
 /*!
- * \brief Blocks until all pool threads have joined
+ * \brief Blocks until all pool threads have joined.
+ * If stop() was not called before, all outstanding tasks are executed first.
  */
 void join();
 
 /*!
  * \brief Waits until there are no more tasks on the queue.
  * Does not stop execution and does not join.
+ * Use a Task_Group to only wait for a subset of the tasks.
  */
 void wait_for_tasks_done() const;
 
 /*!
  * \brief Adds the currently executing thread to the thread pool
+ * Blocks until the pool is stopped or joined.
  */
 void attach_current_thread();
 
 /*!
- * \brief Attaches the specified number of threads to the pool
+ * \brief Starts the specified number of additional pool threads
  * \param num_threads
  */
-[[gnu::error("Not currently supported")]] void attach_threads(uint num_threads);
+void attach_threads(uint num_threads);
 
 
 /*!
- * \brief Detaches the specified number of threads to the pool
- * Currently not supported!
- * \param num_threads
+ * \brief Detaches the specified number of pool threads.
+ * Returns immediately; each detached thread finishes its current task and exits.
+ * Tasks left in its deque are stolen by the remaining workers.
+ * Threads added with attach_current_thread() are never detached.
+ * \param num_threads: Clamped to the number of pool threads
+ */
+void detach_threads(uint num_threads);
+
+/*!
+ * \brief Number of pool threads, including pending attach_threads() / detach_threads() changes.
+ * Does not count threads added with attach_current_thread().
+ */
+[[nodiscard]] uint thread_count() const;
+
+/*!
+ * \brief NUMA node ids of the worker groups, in ascending order. Empty if the pool is not split by NUMA node.
+ */
+[[nodiscard]] std::vector<int> numa_nodes() const;
+
+/*!
+ * \brief NUMA node of the worker group the calling thread belongs to.
+ * \return -1 if the calling thread is no worker of a pool, or its pool is not split by NUMA node
+ */
+[[nodiscard]] static int current_node();
+
+/*!
+ * \brief Number of queued (not yet started) tasks per priority level.
+ * The DEFAULT_PRIORITY entry counts the tasks in the work-stealing deques.
  */
-[[gnu::error("Not currently supported")]] void detach_threads(uint num_threads);
+[[nodiscard]] std::map<int, std::size_t> queue_depths() const;
+
+/*!
+ * \brief Sets after how much waiting time a prioritized task gains one priority level.
+ * Zero disables aging. The default is 10ms.
+ */
+void set_priority_aging_interval(std::chrono::steady_clock::duration aging_interval);
+
+/*!
+ * \brief Starts a supervisor thread that adjusts the number of pool threads
+ * to the queue depth and idle time within the bounds of config.
+ * Replaces a previously enabled configuration.
+ */
+void enable_auto_scaling(const Auto_Scaling_Config &config);
+
+/*!
+ * \brief Stops the supervisor thread. Keeps the current number of threads.
+ */
+void disable_auto_scaling();
+
+#ifdef DT_POOL_METRICS
+    struct Worker_Metrics
+    {
+        std::size_t queue_depth; //Local deque and inbox
+        int numa_node; //-1 if the pool is not split by NUMA node
+        std::uint64_t tasks_executed;
+        std::chrono::nanoseconds busy_time; //Executing tasks
+        std::chrono::nanoseconds idle_time; //Looking for work, spinning and parked
+    };
+
+    struct Metrics
+    {
+        std::vector<Worker_Metrics> workers; //By worker slot, including slots without a thread
+        std::size_t priority_queue_depth;
+        Latency_Histogram::Snapshot queue_latency; //Enqueue to start, all workers
+        Latency_Histogram::Snapshot run_latency; //Start to finish, all workers
+    };
+
+/*!
+ * \brief Lock-free snapshot of the pool metrics. Counters of different workers are not read atomically together.
+ */
+[[nodiscard]] Metrics metrics() const;
+#endif
 
 private:
-    boost::asio::thread_pool m_pool;
-    unsigned long long m_thread_count;
+    using Task = Pool_Task;
+    using Timer_Node_Ptr = Timer_Wheel<Timer_Task>::Node_Ptr;
+
+    struct Timer_Task
+    {
+        Task task;
+        std::chrono::steady_clock::duration period; //Zero for one-shot timers
+        bool in_flight{false}; //A run of this periodic timer is queued or executing. Guarded by m_timer_mut
+    };
+
+    struct Cancel_State
+    {
+        //Forwards stop requests of a caller's token to the task's own source
+        struct Forward_Stop
+        {
+            std::stop_source target;
+            void operator()() const noexcept { target.request_stop(); }
+        };
+
+        explicit Cancel_State(const std::stop_token &external_token)
+        {
+            if(external_token.stop_possible())
+            {
+                forward_stop.emplace(external_token, Forward_Stop{stop_source});
+            }
+        }
+
+        //Pending -> Running, unless the task was cancelled or expired before
+        [[nodiscard]] bool try_start(std::chrono::steady_clock::time_point deadline)
+        {
+            Task_Status expected = Task_Status::Pending;
+            if(stop_source.stop_requested())
+            {
+                status.compare_exchange_strong(expected, Task_Status::Cancelled);
+                return false;
+            }
+            if(deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() > deadline)
+            {
+                status.compare_exchange_strong(expected, Task_Status::Expired);
+                return false;
+            }
+            return status.compare_exchange_strong(expected, Task_Status::Running);
+        }
+
+        std::stop_source stop_source;
+        std::optional<std::stop_callback<Forward_Stop>> forward_stop;
+        std::atomic<Task_Status> status{Task_Status::Pending};
+        std::exception_ptr exception; //Written before status becomes Failed
+    };
+
+    //Marks a cancellable task as discarded if the pool destroys it without running it
+    struct Discard_Guard
+    {
+        explicit Discard_Guard(std::shared_ptr<Cancel_State> IN_state) : state(std::move(IN_state)) {}
+        ~Discard_Guard()
+        {
+            if(state)
+            {
+                Task_Status expected = Task_Status::Pending;
+                state->status.compare_exchange_strong(expected, Task_Status::Discarded);
+            }
+        }
+
+        Discard_Guard(Discard_Guard &&rhs) noexcept = default;
+        Discard_Guard& operator=(Discard_Guard &&rhs) = delete;
+        Discard_Guard(const Discard_Guard &rhs) = delete;
+        Discard_Guard& operator=(const Discard_Guard &rhs) = delete;
+
+        std::shared_ptr<Cancel_State> state;
+    };
+
+    //Shared by all chunks of one parallel_for(). The last chunk to finish fulfills the promise
+    template<typename Functor>
+    struct Bulk_State
+    {
+        Bulk_State(std::size_t num_chunks, Functor &&f) : remaining_chunks(num_chunks), functor(std::move(f)) {}
+        Bulk_State(std::size_t num_chunks, const Functor &f) : remaining_chunks(num_chunks), functor(f) {}
+
+        template<typename Body>
+        void run_chunk(Body &&body) noexcept
+        {
+            if(!failed.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    body();
+                }
+                catch(...)
+                {
+                    if(!failed.exchange(true))
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            if(remaining_chunks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                if(error)
+                {
+                    promise.set_exception(error);
+                }
+                else
+                {
+                    promise.set_value();
+                }
+            }
+        }
+
+        std::atomic<std::size_t> remaining_chunks;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::promise<void> promise;
+        const Functor functor;
+    };
+
+    template<typename result_t, typename Functor, typename... argtypes>
+    static void fulfill_promise(std::promise<result_t> &promise, Functor&& f, argtypes&&... args) noexcept
+    {
+        try
+        {
+            if constexpr(std::is_void_v<result_t>)
+            {
+                std::invoke(std::forward<Functor>(f), std::forward<argtypes>(args)...);
+                promise.set_value();
+            }
+            else
+            {
+                promise.set_value(std::invoke(std::forward<Functor>(f), std::forward<argtypes>(args)...));
+            }
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    struct Worker
+    {
+        Work_Stealing_Queue<Task> queue; //Tasks posted by the worker itself
+        Work_Stealing_Queue<Task> inbox; //Tasks posted from outside the pool, only taken FIFO
+        std::thread thread;
+        bool owned{false}; //Is a thread running this worker's loop? Guarded by m_worker_admin_mut
+        std::atomic<std::size_t> group_idx{0}; //Changed under m_worker_admin_mut when a thread claims the slot
+#ifdef DT_POOL_METRICS
+        //Only written by the thread running this worker's loop
+        std::atomic<std::uint64_t> tasks_executed{0};
+        std::atomic<std::int64_t> busy_ns{0};
+        std::atomic<std::int64_t> idle_ns{0};
+        Latency_Histogram queue_latency;
+        Latency_Histogram run_latency;
+#endif
+    };
+
+    struct Worker_Group
+    {
+        Worker_Group(int IN_node_id, std::vector<int> IN_cpus) : node_id(IN_node_id), cpus(std::move(IN_cpus)) {}
+
+        const int node_id; //-1 if the pool is not split by NUMA node
+        const std::vector<int> cpus; //Empty for no restriction
+        Work_Stealing_Queue<Task> inbox; //Tasks posted with post_on_node(), only taken FIFO
+    };
+
+    static constexpr std::size_t MAX_WORKERS = 256;
+    static constexpr unsigned int SPIN_ROUNDS_BEFORE_PARK = 32;
+    static constexpr std::size_t AUTO_CHUNKS_PER_WORKER = 4;
+
+    [[nodiscard]] bool begin_enqueue(std::size_t num_tasks);
+    void end_enqueue();
+    void enqueue(Task &&task, int priority = NS_priority_mutex::DEFAULT_PRIORITY);
+    void enqueue_bulk(std::span<Task> tasks);
+    void enqueue_on_node(int node, Task &&task);
+    void task_done(unsigned long long num_tasks = 1);
+    [[nodiscard]] std::size_t auto_grain(std::size_t range_size) const;
+
+    std::size_t claim_worker_slot();
+    std::size_t claim_worker_slot_locked(); //Caller must hold m_worker_admin_mut
+    void release_worker_slot(std::size_t worker_idx);
+    [[nodiscard]] std::size_t least_loaded_group_locked() const; //Caller must hold m_worker_admin_mut
+    [[nodiscard]] std::size_t group_of_cpu(int cpu) const;
+    [[nodiscard]] bool steal_task(std::size_t worker_idx, bool same_group, Task &OUT_task);
+    void worker_loop(std::size_t worker_idx, bool may_retire);
+    [[nodiscard]] bool try_retire();
+    [[nodiscard]] std::size_t queued_task_count() const;
+    void auto_scaling_loop(std::stop_token stop_token, Auto_Scaling_Config config);
+    [[nodiscard]] bool find_task(std::size_t worker_idx, Task &OUT_task);
+    [[nodiscard]] bool has_queued_tasks() const;
+    [[nodiscard]] bool should_exit() const;
+    [[nodiscard]] bool wait_for_work(bool may_retire);
+    void wake_one_worker();
+    void wake_workers(std::size_t num_tasks);
+    void wake_all_workers();
+    void discard_queued_tasks();
+    Timer_Handle add_timer(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration period, Task &&task);
+    bool cancel_timer(const Timer_Node_Ptr &node);
+    void timer_loop(std::stop_token stop_token);
+    void stop_timers();
+
+    std::vector<std::unique_ptr<Worker_Group>> m_groups; //Fixed after construction, at least one
+    //Slots are only ever appended, so workers can scan [0, m_worker_count) without locking
+    std::array<std::unique_ptr<Worker>, MAX_WORKERS> m_workers;
+    std::atomic<std::size_t> m_worker_count{0};
+    std::atomic<std::size_t> m_next_worker{0};
+    Priority_Task_Queue<Task> m_priority_tasks; //Every task not posted with DEFAULT_PRIORITY
+    std::mutex m_worker_admin_mut;
+    std::atomic<uint> m_thread_count{0}; //Pool threads minus pending retirements, changed under m_worker_admin_mut
+    std::atomic<uint> m_retire_requests{0};
+
+    std::atomic<bool> m_stopped{false};
+    std::atomic<bool> m_joining{false};
+
+    std::mutex m_idle_mut;
+    std::condition_variable m_idle_cv;
+    std::atomic<unsigned int> m_idle_workers{0};
+
+    std::atomic<unsigned long long> m_current_tasks{0};
 
+    std::mutex m_auto_scaling_mut; //Serializes enable/disable of the supervisor
+    std::jthread m_auto_scaling_thread;
 
-    mutable std::mutex m_curr_task_update_mut;
-    mutable std::condition_variable m_tasks_done_cv;
-    unsigned long long m_current_tasks{0};
+    std::mutex m_timer_mut;
+    std::condition_variable_any m_timer_cv;
+    Timer_Wheel<Timer_Task> m_timers; //Guarded by m_timer_mut
+    std::chrono::steady_clock::time_point m_timer_wakeup{std::chrono::steady_clock::time_point::max()}; //Guarded by m_timer_mut
+    bool m_timer_rescan{false}; //Guarded by m_timer_mut
+    std::jthread m_timer_thread; //Started with the first timer
 };
 
 } //NS_concurrency
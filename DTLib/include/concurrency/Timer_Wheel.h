@@ -0,0 +1,250 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Hierarchical timer wheel with NUM_LEVELS levels of NUM_SLOTS slots each.
+ * Level 0 has one slot per tick, every slot of level n covers NUM_SLOTS^n ticks.
+ * A timer is placed in the lowest level whose range covers its deadline and moved down one level
+ * whenever the level below wraps around, so insert() and erase() are O(1)
+ * and advance() costs O(1) per tick plus O(1) per moved or expired timer.
+ * With the default tick of 1ms the wheel covers 4.6 hours, later deadlines wait in the top level and are re-placed.
+ * Timers never expire before their deadline, but up to one tick late.
+ * Not synchronized.
+ */
+template<typename T>
+class Timer_Wheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    class Node;
+    using Node_Ptr = std::shared_ptr<Node>;
+
+    class Node
+    {
+    public:
+        Node(clock::time_point deadline, T &&IN_element) : element(std::move(IN_element)), mDeadline(deadline) {}
+
+        [[nodiscard]] clock::time_point deadline() const noexcept { return mDeadline; }
+        [[nodiscard]] bool scheduled() const noexcept { return mSlot != nullptr; }
+
+        T element;
+
+    private:
+        friend class Timer_Wheel;
+
+        clock::time_point mDeadline;
+        std::uint64_t mExpiry_tick{0};
+        std::list<Node_Ptr> *mSlot{nullptr}; //nullptr once expired or erased
+        typename std::list<Node_Ptr>::iterator mPos;
+    };
+
+    static constexpr std::size_t SLOT_BITS = 6;
+    static constexpr std::size_t NUM_SLOTS = std::size_t{1} << SLOT_BITS;
+    static constexpr std::size_t NUM_LEVELS = 4;
+
+    explicit Timer_Wheel(clock::duration tick = std::chrono::milliseconds(1), clock::time_point start = clock::now())
+        : mTick(tick), mStart(start) {}
+
+    Timer_Wheel(const Timer_Wheel &rhs) = delete;
+    Timer_Wheel& operator=(const Timer_Wheel &rhs) = delete;
+
+    Node_Ptr insert(clock::time_point deadline, T &&IN_element);
+    void reschedule(const Node_Ptr &node, clock::time_point deadline); //node must not be scheduled
+    bool erase(const Node_Ptr &node); //retval false if node already expired or was erased
+    void advance(clock::time_point now, std::vector<Node_Ptr> &OUT_expired); //Appends every node whose deadline has passed
+    [[nodiscard]] std::optional<clock::time_point> next_wakeup() const; //Earliest time advance() can have work, nullopt if empty
+    [[nodiscard]] std::size_t size() const noexcept { return mSize; }
+    [[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+    void clear(std::vector<Node_Ptr> &OUT_removed); //Hands out the nodes, so the caller can destroy them outside its lock
+
+private:
+    using Slot = std::list<Node_Ptr>;
+
+    [[nodiscard]] std::uint64_t deadline_tick(clock::time_point deadline) const;
+    [[nodiscard]] clock::time_point tick_time(std::uint64_t tick) const;
+    [[nodiscard]] Slot& slot_for(std::uint64_t expiry_tick);
+    void process_tick(std::uint64_t tick, std::vector<Node_Ptr> &OUT_expired);
+
+    std::array<std::array<Slot, NUM_SLOTS>, NUM_LEVELS> mLevels;
+    clock::duration mTick;
+    clock::time_point mStart;
+    std::uint64_t mCurrent_tick{0}; //Last processed tick
+    std::size_t mSize{0};
+};
+
+
+template<typename T>
+typename Timer_Wheel<T>::Node_Ptr Timer_Wheel<T>::insert(clock::time_point deadline, T &&IN_element)
+{
+    Node_Ptr node = std::make_shared<Node>(deadline, std::move(IN_element));
+    reschedule(node, deadline);
+    return node;
+}
+
+template<typename T>
+void Timer_Wheel<T>::reschedule(const Node_Ptr &node, clock::time_point deadline)
+{
+    //The current tick was already processed
+    node->mDeadline = deadline;
+    node->mExpiry_tick = std::max(deadline_tick(deadline), mCurrent_tick + 1);
+    Slot &slot = slot_for(node->mExpiry_tick);
+    node->mPos = slot.insert(slot.end(), node);
+    node->mSlot = &slot;
+    ++mSize;
+}
+
+template<typename T>
+bool Timer_Wheel<T>::erase(const Node_Ptr &node)
+{
+    if(node->mSlot == nullptr)
+    {
+        return false;
+    }
+    //The list may hold the last reference to node
+    Node_Ptr keep_alive = node;
+    node->mSlot->erase(node->mPos);
+    node->mSlot = nullptr;
+    --mSize;
+    return true;
+}
+
+template<typename T>
+void Timer_Wheel<T>::advance(clock::time_point now, std::vector<Node_Ptr> &OUT_expired)
+{
+    const std::uint64_t now_tick = now < mStart ? 0 : static_cast<std::uint64_t>((now - mStart) / mTick);
+    if(mSize == 0)
+    {
+        mCurrent_tick = std::max(mCurrent_tick, now_tick);
+        return;
+    }
+    while(mCurrent_tick < now_tick)
+    {
+        process_tick(mCurrent_tick + 1, OUT_expired);
+    }
+}
+
+template<typename T>
+std::optional<typename Timer_Wheel<T>::clock::time_point> Timer_Wheel<T>::next_wakeup() const
+{
+    if(mSize == 0)
+    {
+        return std::nullopt;
+    }
+    //Either a level 0 slot expires or level 0 wraps around and higher levels move down
+    for(std::uint64_t tick = mCurrent_tick + 1; ; ++tick)
+    {
+        const std::size_t slot_idx = tick & (NUM_SLOTS - 1);
+        if(slot_idx == 0 || !mLevels[0][slot_idx].empty())
+        {
+            return tick_time(tick);
+        }
+    }
+}
+
+template<typename T>
+void Timer_Wheel<T>::clear(std::vector<Node_Ptr> &OUT_removed)
+{
+    for(auto &level : mLevels)
+    {
+        for(Slot &slot : level)
+        {
+            for(Node_Ptr &node : slot)
+            {
+                node->mSlot = nullptr;
+                OUT_removed.push_back(std::move(node));
+            }
+            slot.clear();
+        }
+    }
+    mSize = 0;
+}
+
+template<typename T>
+std::uint64_t Timer_Wheel<T>::deadline_tick(clock::time_point deadline) const
+{
+    if(deadline <= mStart)
+    {
+        return 0;
+    }
+    //Round up, timers must not expire early
+    return static_cast<std::uint64_t>((deadline - mStart + mTick - clock::duration(1)) / mTick);
+}
+
+template<typename T>
+typename Timer_Wheel<T>::clock::time_point Timer_Wheel<T>::tick_time(std::uint64_t tick) const
+{
+    return mStart + mTick * static_cast<clock::rep>(tick);
+}
+
+template<typename T>
+typename Timer_Wheel<T>::Slot& Timer_Wheel<T>::slot_for(std::uint64_t expiry_tick)
+{
+    //Deadlines beyond the range of the wheel go to the farthest slot and are re-placed from there
+    constexpr std::uint64_t max_delta = (std::uint64_t{1} << (SLOT_BITS * NUM_LEVELS)) - 1;
+    const std::uint64_t delta = expiry_tick - mCurrent_tick;
+    const std::uint64_t placement_tick = delta > max_delta ? mCurrent_tick + max_delta : expiry_tick;
+
+    std::size_t level = 0;
+    while(level + 1 < NUM_LEVELS && delta >= (std::uint64_t{1} << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    return mLevels[level][(placement_tick >> (SLOT_BITS * level)) & (NUM_SLOTS - 1)];
+}
+
+template<typename T>
+void Timer_Wheel<T>::process_tick(std::uint64_t tick, std::vector<Node_Ptr> &OUT_expired)
+{
+    mCurrent_tick = tick;
+
+    //Move timers down, top level first, so that they can cascade through several levels within this tick
+    std::size_t top_level = 0;
+    while(top_level + 1 < NUM_LEVELS && (tick & ((std::uint64_t{1} << (SLOT_BITS * (top_level + 1))) - 1)) == 0)
+    {
+        ++top_level;
+    }
+    for(std::size_t level = top_level; level > 0; --level)
+    {
+        Slot &slot = mLevels[level][(tick >> (SLOT_BITS * level)) & (NUM_SLOTS - 1)];
+        Slot pending;
+        pending.swap(slot);
+        while(!pending.empty())
+        {
+            //splice() keeps mPos valid, the node only has to learn its new slot
+            Node &node = *pending.front();
+            Slot &target = slot_for(std::max(node.mExpiry_tick, tick));
+            target.splice(target.end(), pending, pending.begin());
+            node.mSlot = &target;
+        }
+    }
+
+    Slot &due = mLevels[0][tick & (NUM_SLOTS - 1)];
+    for(Node_Ptr &node : due)
+    {
+        node->mSlot = nullptr;
+        OUT_expired.push_back(std::move(node));
+    }
+    mSize -= due.size();
+    due.clear();
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,163 @@
+#ifndef WORK_STEALING_QUEUE_H
+#define WORK_STEALING_QUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace NS_dtools
+{
+
+namespace NS_concurrency
+{
+
+/*!
+ * \brief Per-worker task deque for work stealing.
+ * The owning worker pushes and pops at the back (LIFO, keeps the cache hot for nested tasks),
+ * other workers steal from the front (FIFO, takes the oldest and usually largest chunks of work).
+ * Each deque has its own lock, so in the common case only its owner ever touches it.
+ * The element count is mirrored in an atomic so empty deques can be skipped without locking.
+ * Elements live in a ring buffer that only grows, so a warmed-up queue does not allocate.
+ * T has to be default constructible and move assignable.
+ */
+template<typename T>
+class Work_Stealing_Queue
+{
+public:
+    void push(T &&IN_element); //blocking, but only in respect to other operations on this queue
+    void push_bulk(std::span<T> IN_elements); //moves all elements in, taking the lock only once
+    [[nodiscard]] bool pop(T &OUT_element); //LIFO end. retval false if queue was empty
+    [[nodiscard]] bool steal(T &OUT_element); //FIFO end. retval false if queue was empty
+    [[nodiscard]] bool empty() const; //non-blocking
+    [[nodiscard]] std::size_t size() const; //non-blocking
+    std::size_t clear(); //retval is the number of discarded elements
+private:
+    void grow(std::size_t min_capacity); //Caller must hold mMut
+
+    static constexpr std::size_t INITIAL_CAPACITY = 64;
+
+    mutable std::mutex mMut;
+    std::vector<T> mRing_buffer; //Capacity is zero or a power of two
+    std::size_t mHead{0}; //Index of the front element
+    std::atomic<std::size_t> mSize{0};
+};
+
+
+template<typename T>
+void Work_Stealing_Queue<T>::push(T &&IN_element)
+{
+    std::lock_guard<std::mutex> lk(mMut);
+    const std::size_t curr_size = mSize.load(std::memory_order_relaxed);
+    if(curr_size == mRing_buffer.size())
+    {
+        grow(curr_size + 1);
+    }
+    mRing_buffer[(mHead + curr_size) & (mRing_buffer.size() - 1)] = std::move(IN_element);
+    mSize.store(curr_size + 1);
+}
+
+template<typename T>
+void Work_Stealing_Queue<T>::push_bulk(std::span<T> IN_elements)
+{
+    std::lock_guard<std::mutex> lk(mMut);
+    const std::size_t curr_size = mSize.load(std::memory_order_relaxed);
+    if(curr_size + IN_elements.size() > mRing_buffer.size())
+    {
+        grow(curr_size + IN_elements.size());
+    }
+    const std::size_t mask = mRing_buffer.size() - 1;
+    for(std::size_t elem_idx = 0; elem_idx < IN_elements.size(); ++elem_idx)
+    {
+        mRing_buffer[(mHead + curr_size + elem_idx) & mask] = std::move(IN_elements[elem_idx]);
+    }
+    mSize.store(curr_size + IN_elements.size());
+}
+
+template<typename T>
+bool Work_Stealing_Queue<T>::pop(T &OUT_element)
+{
+    if(empty())
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(mMut);
+    const std::size_t curr_size = mSize.load(std::memory_order_relaxed);
+    if(curr_size == 0)
+    {
+        return false;
+    }
+    OUT_element = std::move(mRing_buffer[(mHead + curr_size - 1) & (mRing_buffer.size() - 1)]);
+    mSize.store(curr_size - 1);
+    return true;
+}
+
+template<typename T>
+bool Work_Stealing_Queue<T>::steal(T &OUT_element)
+{
+    if(empty())
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(mMut);
+    const std::size_t curr_size = mSize.load(std::memory_order_relaxed);
+    if(curr_size == 0)
+    {
+        return false;
+    }
+    OUT_element = std::move(mRing_buffer[mHead]);
+    mHead = (mHead + 1) & (mRing_buffer.size() - 1);
+    mSize.store(curr_size - 1);
+    return true;
+}
+
+template<typename T>
+bool Work_Stealing_Queue<T>::empty() const
+{
+    return mSize.load() == 0;
+}
+
+template<typename T>
+std::size_t Work_Stealing_Queue<T>::size() const
+{
+    return mSize.load();
+}
+
+template<typename T>
+std::size_t Work_Stealing_Queue<T>::clear()
+{
+    std::vector<T> discarded;
+    std::size_t num_discarded = 0;
+    {
+        std::lock_guard<std::mutex> lk(mMut);
+        discarded.swap(mRing_buffer);
+        num_discarded = mSize.load(std::memory_order_relaxed);
+        mHead = 0;
+        mSize.store(0);
+    }
+    //Elements are destroyed outside of the lock
+    return num_discarded;
+}
+
+template<typename T>
+void Work_Stealing_Queue<T>::grow(std::size_t min_capacity)
+{
+    const std::size_t curr_size = mSize.load(std::memory_order_relaxed);
+    std::size_t new_capacity = mRing_buffer.empty() ? INITIAL_CAPACITY : mRing_buffer.size() * 2;
+    while(new_capacity < min_capacity)
+    {
+        new_capacity *= 2;
+    }
+    std::vector<T> new_buffer(new_capacity);
+    for(std::size_t elem_idx = 0; elem_idx < curr_size; ++elem_idx)
+    {
+        new_buffer[elem_idx] = std::move(mRing_buffer[(mHead + elem_idx) & (mRing_buffer.size() - 1)]);
+    }
+    mRing_buffer.swap(new_buffer);
+    mHead = 0;
+}
+
+} //NS_concurrency
+} //NS_dtools
+
+#endif // WORK_STEALING_QUEUE_H
@@ -0,0 +1,194 @@
+#include "concurrency/CPU_Topology.h"
+#include <DTools/MiscTools.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+namespace
+{
+
+//First line of a sysfs attribute, empty if it cannot be read
+std::string read_attribute(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+int parse_cpu_number(std::string_view text, std::string_view cpu_list)
+{
+    int cpu = -1;
+    const auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+    if(err != std::errc() || end != text.data() + text.size() || cpu < 0)
+    {
+        throw NS_misc::OmegaException<std::string>("Malformed CPU list: ", std::string(cpu_list));
+    }
+    return cpu;
+}
+
+}
+
+CPU_Topology CPU_Topology::detect()
+{
+#ifdef __linux__
+    CPU_Topology result = from_sysfs("/sys");
+    if(!result.mNodes.empty())
+    {
+        return result;
+    }
+#endif
+    std::vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+    for(std::size_t cpu_idx = 0; cpu_idx < cpus.size(); ++cpu_idx)
+    {
+        cpus[cpu_idx] = static_cast<int>(cpu_idx);
+    }
+    return single_node(std::move(cpus));
+}
+
+CPU_Topology CPU_Topology::from_sysfs(const std::filesystem::path &root)
+{
+    const std::filesystem::path system_dir = root / "devices" / "system";
+    const std::string online_list = read_attribute(system_dir / "cpu" / "online");
+    const std::vector<int> online_cpus = online_list.empty() ? std::vector<int>() : parse_cpu_list(online_list);
+
+    CPU_Topology result;
+    std::error_code ec;
+    for(const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(system_dir / "node", ec))
+    {
+        const std::string name = entry.path().filename().string();
+        int node_id = -1;
+        if(!name.starts_with("node")
+           || std::from_chars(name.data() + 4, name.data() + name.size(), node_id).ptr != name.data() + name.size())
+        {
+            continue;
+        }
+
+        Node node{node_id, parse_cpu_list(read_attribute(entry.path() / "cpulist"))};
+        if(!online_cpus.empty())
+        {
+            std::erase_if(node.cpus, [&online_cpus](int cpu){ return !std::binary_search(online_cpus.begin(), online_cpus.end(), cpu); });
+        }
+        //Memory-only nodes have no CPUs to run workers on
+        if(!node.cpus.empty())
+        {
+            result.mNodes.push_back(std::move(node));
+        }
+    }
+
+    if(result.mNodes.empty() && !online_cpus.empty())
+    {
+        return single_node(online_cpus);
+    }
+    std::sort(result.mNodes.begin(), result.mNodes.end(), [](const Node &lhs, const Node &rhs){ return lhs.id < rhs.id; });
+    return result;
+}
+
+CPU_Topology CPU_Topology::single_node(std::vector<int> cpus)
+{
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    CPU_Topology result;
+    result.mNodes.push_back(Node{0, std::move(cpus)});
+    return result;
+}
+
+std::vector<int> CPU_Topology::parse_cpu_list(std::string_view cpu_list)
+{
+    std::vector<int> result;
+    while(!cpu_list.empty() && (cpu_list.back() == '\n' || cpu_list.back() == ' '))
+    {
+        cpu_list.remove_suffix(1);
+    }
+
+    std::string_view remaining = cpu_list;
+    while(!remaining.empty())
+    {
+        const std::size_t comma_pos = remaining.find(',');
+        const std::string_view range = remaining.substr(0, comma_pos);
+        remaining = comma_pos == std::string_view::npos ? std::string_view() : remaining.substr(comma_pos + 1);
+
+        const std::size_t dash_pos = range.find('-');
+        const int first = parse_cpu_number(range.substr(0, dash_pos), cpu_list);
+        const int last = dash_pos == std::string_view::npos ? first : parse_cpu_number(range.substr(dash_pos + 1), cpu_list);
+        if(last < first)
+        {
+            throw NS_misc::OmegaException<std::string>("Malformed CPU list: ", std::string(cpu_list));
+        }
+        for(int cpu = first; cpu <= last; ++cpu)
+        {
+            result.push_back(cpu);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::size_t CPU_Topology::cpu_count() const noexcept
+{
+    std::size_t result = 0;
+    for(const Node &node : mNodes)
+    {
+        result += node.cpus.size();
+    }
+    return result;
+}
+
+int CPU_Topology::node_of_cpu(int cpu) const noexcept
+{
+    for(const Node &node : mNodes)
+    {
+        if(std::binary_search(node.cpus.begin(), node.cpus.end(), cpu))
+        {
+            return node.id;
+        }
+    }
+    return -1;
+}
+
+bool NS_concurrency::pin_current_thread(std::span<const int> cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if(cpus.empty())
+    {
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    for(int cpu : cpus)
+    {
+        if(cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return cpus.empty();
+#endif
+}
+
+int NS_concurrency::current_cpu() noexcept
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
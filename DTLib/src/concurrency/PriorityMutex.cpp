@@ -1,30 +1,259 @@
 #include "concurrency/PriorityMutex.h"
 #include "debug.h"
 
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 using namespace NS_dtools;
 using namespace NS_concurrency::NS_priority_mutex;
 
+namespace
+{
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free,
+              "futex words must be plain 32 bit integers");
+
+//Sleeps while word == expected, at most until deadline. May return spuriously
+void park(std::atomic<std::uint32_t> &word, std::uint32_t expected, std::chrono::steady_clock::time_point deadline) noexcept
+{
+    if(deadline == NS_detail::NO_DEADLINE)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        word.wait(expected, std::memory_order_acquire);
+#endif
+        return;
+    }
+
+    const std::chrono::steady_clock::duration rel_time = deadline - std::chrono::steady_clock::now();
+    if(rel_time <= rel_time.zero())
+    {
+        return;
+    }
+#ifdef __linux__
+    const auto secs = std::chrono::duration_cast<std::chrono::seconds>(rel_time);
+    const timespec timeout{static_cast<time_t>(secs.count()), static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(rel_time - secs).count())};
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, &timeout, nullptr, 0);
+#else
+    //std::atomic::wait has no timeout, poll instead
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(rel_time, std::chrono::microseconds(100)));
+#endif
+}
+
+void unpark_one(std::atomic<std::uint32_t> &word) noexcept
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    word.notify_one();
+#endif
+}
+
+}
+
+NS_detail::Adaptive_Spinner::Adaptive_Spinner(const Spin_Config &config)
+    : mMax_spins(std::thread::hardware_concurrency() > 1 ? config.max_spins : 0),
+      mAdaptive(config.adaptive),
+      mBudget(config.adaptive ? std::min(mMax_spins, MIN_SPINS * 4) : mMax_spins)
+{
+}
+
+void NS_detail::Adaptive_Spinner::learn(unsigned int spins, bool success) noexcept
+{
+    if(!mAdaptive)
+    {
+        return;
+    }
+    //Moves 1/8 of the way to the target, concurrent updates may get lost, which does not matter for an estimate
+    const long budget = mBudget.load(std::memory_order_relaxed);
+    const long target = success ? std::min<long>(2L * spins + MIN_SPINS, mMax_spins) : budget / 2;
+    const long next_budget = std::clamp<long>(budget + (target - budget) / 8, std::min(MIN_SPINS, mMax_spins), mMax_spins);
+    mBudget.store(static_cast<unsigned int>(next_budget), std::memory_order_relaxed);
+}
+
+void NS_detail::Waiter_Queue::push(Lock_Waiter &waiter)
+{
+    Level &level = mLevels[waiter.priority];
+    waiter.prev = level.tail;
+    waiter.next = nullptr;
+    if(level.tail != nullptr)
+    {
+        level.tail->next = &waiter;
+    }
+    else
+    {
+        level.head = &waiter;
+    }
+    level.tail = &waiter;
+}
+
+void NS_detail::Waiter_Queue::remove(Lock_Waiter &waiter)
+{
+    const auto level_it = mLevels.find(waiter.priority);
+    DEBUG_ASSERT(level_it != mLevels.end() && "Waiter_Queue::remove: waiter is not queued!");
+    Level &level = level_it->second;
+    (waiter.prev != nullptr ? waiter.prev->next : level.head) = waiter.next;
+    (waiter.next != nullptr ? waiter.next->prev : level.tail) = waiter.prev;
+    waiter.prev = nullptr;
+    waiter.next = nullptr;
+    if(level.head == nullptr)
+    {
+        mLevels.erase(level_it);
+    }
+}
+
+void NS_detail::grant(Lock_Waiter &waiter) noexcept
+{
+    std::uint32_t expected = Lock_Waiter::WAITING;
+    if(waiter.grant_state.compare_exchange_strong(expected, Lock_Waiter::GRANTED, std::memory_order_release, std::memory_order_relaxed))
+    {
+        //Still spinning, no system call needed
+        return;
+    }
+    //The waiter cannot leave before GRANTED, so grant_state stays valid until then
+    waiter.grant_state.store(Lock_Waiter::WAKING, std::memory_order_relaxed);
+    unpark_one(waiter.grant_state);
+    waiter.grant_state.store(Lock_Waiter::GRANTED, std::memory_order_release);
+}
+
+bool NS_detail::wait_for_grant(Lock_Waiter &waiter, Adaptive_Spinner &spinner, std::chrono::steady_clock::time_point deadline) noexcept
+{
+    const bool granted_while_spinning = spinner.spin([&waiter]()
+    {
+        return waiter.grant_state.load(std::memory_order_acquire) == Lock_Waiter::WAITING ? Spin_Step::Retry : Spin_Step::Done;
+    });
+
+    if(!granted_while_spinning)
+    {
+        std::uint32_t expected = Lock_Waiter::WAITING;
+        if(waiter.grant_state.compare_exchange_strong(expected, Lock_Waiter::PARKED, std::memory_order_relaxed))
+        {
+            while(waiter.grant_state.load(std::memory_order_relaxed) == Lock_Waiter::PARKED)
+            {
+                if(deadline != NO_DEADLINE && std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+                park(waiter.grant_state, Lock_Waiter::PARKED, deadline);
+            }
+        }
+    }
+
+    //Only WAKING is left, the granting thread is in its wake-up call
+    while(waiter.grant_state.load(std::memory_order_acquire) != Lock_Waiter::GRANTED)
+    {
+        std::this_thread::yield();
+    }
+    return true;
+}
+
 void Priority_Mutex::lock(int prioritylvl)
 {
-    std::unique_lock<decltype(mMut)> lk(mMut);
+    lock_until(prioritylvl, NS_detail::NO_DEADLINE);
+}
 
-    lockPriorities.push(prioritylvl);
+bool Priority_Mutex::try_lock(int)
+{
+    std::uint32_t expected = 0;
+    return mState.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+}
 
-    while(lockPriorities.top() != prioritylvl)
+bool Priority_Mutex::lock_until(int prioritylvl, std::chrono::steady_clock::time_point deadline)
+{
+    std::uint32_t expected = 0;
+    if(mState.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
     {
-        mCondV.wait(lk, [&]{
-            return !locked && (lockPriorities.top() == prioritylvl);
-        });
+        return true;
     }
-    locked = true;
+
+    //Spinning threads must not overtake queued waiters
+    const bool acquired = mSpinner.spin([this]()
+    {
+        std::uint32_t state = mState.load(std::memory_order_relaxed);
+        if(state & QUEUED)
+        {
+            return NS_detail::Spin_Step::Abort;
+        }
+        return state == 0 && mState.compare_exchange_weak(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)
+               ? NS_detail::Spin_Step::Done : NS_detail::Spin_Step::Retry;
+    });
+    return acquired || lock_slow(prioritylvl, deadline);
 }
 
-void Priority_Mutex::unlock()
+bool Priority_Mutex::lock_slow(int prioritylvl, std::chrono::steady_clock::time_point deadline)
 {
-    std::lock_guard<decltype(mMut)> lk(mMut);
-    DEBUG_ASSERT(!lockPriorities.empty() && "PriorityMutex::unlock: priority queue is empty!");
-    lockPriorities.pop();
-    locked = false;
-    mCondV.notify_all();
+    std::unique_lock<decltype(mAdminMut)> admin_lk(mAdminMut);
+    //From here on, fast paths fail and unlock() takes mAdminMut
+    if((mState.fetch_or(QUEUED, std::memory_order_relaxed) & LOCKED) == 0)
+    {
+        mState.fetch_or(LOCKED, std::memory_order_acquire);
+        if(mWaiters.empty())
+        {
+            mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    if(deadline != NS_detail::NO_DEADLINE && std::chrono::steady_clock::now() >= deadline)
+    {
+        if(mWaiters.empty())
+        {
+            mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    NS_detail::Lock_Waiter waiter(prioritylvl);
+    mWaiters.push(waiter);
+    admin_lk.unlock();
+    //The lock is handed over, LOCKED stays set
+    if(NS_detail::wait_for_grant(waiter, mSpinner, deadline))
+    {
+        return true;
+    }
+
+    //Grants happen under mAdminMut, so from here on the waiter is either granted or still queued
+    admin_lk.lock();
+    if(waiter.grant_state.load(std::memory_order_acquire) == NS_detail::Lock_Waiter::GRANTED)
+    {
+        return true;
+    }
+    mWaiters.remove(waiter);
+    //Queued waiters imply LOCKED, so nobody behind us can take over now
+    if(mWaiters.empty())
+    {
+        mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+    }
+    return false;
 }
 
+void Priority_Mutex::unlock()
+{
+    std::uint32_t expected = LOCKED;
+    if(mState.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    std::lock_guard<decltype(mAdminMut)> admin_lk(mAdminMut);
+    DEBUG_ASSERT((mState.load() & LOCKED) && "PriorityMutex::unlock: mutex is not locked!");
+    NS_detail::Lock_Waiter *const next_owner = mWaiters.front();
+    if(next_owner == nullptr)
+    {
+        mState.store(0, std::memory_order_release);
+        return;
+    }
+
+    mWaiters.remove(*next_owner);
+    if(mWaiters.empty())
+    {
+        mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+    }
+    NS_detail::grant(*next_owner);
+}
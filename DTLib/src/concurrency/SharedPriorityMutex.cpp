@@ -1,88 +1,410 @@
 #include "concurrency/PriorityMutex.h"
 #include "debug.h"
 
+#include <algorithm>
+#include <bit>
+#include <thread>
+
 using namespace NS_dtools;
 using namespace NS_concurrency::NS_priority_mutex;
 
-void Shared_Priority_Mutex::lock(int prioritylvl)
+namespace
 {
-    std::unique_lock<decltype(mMut)> lk(mMut);
 
-    //Push to list must be synchronized even if main Mutex is shared
+std::atomic<std::size_t> gNext_reader_idx{0};
+//Consecutive indices, so threads spread evenly over the reader slots
+thread_local const std::size_t tl_reader_idx = gNext_reader_idx.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::lock_contended(int prioritylvl, std::chrono::steady_clock::time_point deadline)
+{
+    if constexpr(Wait_Policy::spins)
     {
-        std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-        lockPriorities.push(prioritylvl);
+        //Spinning threads must not overtake queued waiters
+        const bool acquired = mSpinner.spin([this]()
+        {
+            std::uint64_t state = mState.load(std::memory_order_relaxed);
+            if(state & QUEUED)
+            {
+                return Spin_Step::Abort;
+            }
+            return state == 0 && mState.compare_exchange_weak(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed)
+                   ? Spin_Step::Done : Spin_Step::Retry;
+        });
+        if(acquired)
+        {
+            return true;
+        }
     }
+    return lock_slow(prioritylvl, Lock_Kind::Exclusive, deadline);
+}
 
-    while(lockPriorities.top() != prioritylvl)
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_slow()
+{
+    //Waiters are queued, hand the lock over
+    std::lock_guard<decltype(mAdminMut)> admin_lk(mAdminMut);
+    DEBUG_ASSERT((mState.load() & WRITER) && "Shared_Priority_Mutex::unlock: mutex is not locked exclusively!");
+    mState.fetch_and(~WRITER, std::memory_order_release);
+    grant_waiters();
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::try_lock_shared(int prioritylvl)
+{
+    std::uint64_t state = mState.load(std::memory_order_relaxed);
+    while((state & (WRITER | QUEUED)) == 0)
     {
-        mCondV.wait(lk, [&]{
-            std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-            return lock_counter == 0 && (lockPriorities.top() == prioritylvl);
+        if(mState.compare_exchange_weak(state, state + READER, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+    if(state & WRITER)
+    {
+        return false;
+    }
+
+    //Waiters are queued behind the readers, we may still outrank them
+    std::lock_guard<decltype(mAdminMut)> admin_lk(mAdminMut);
+    mState.fetch_or(QUEUED, std::memory_order_relaxed);
+    const bool admitted = try_admit(prioritylvl, Lock_Kind::Shared);
+    if(!admitted && !has_waiters())
+    {
+        mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+    }
+    return admitted;
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::lock_shared_contended(int prioritylvl, std::chrono::steady_clock::time_point deadline)
+{
+    if constexpr(Wait_Policy::spins)
+    {
+        const bool acquired = (mState.load(std::memory_order_relaxed) & QUEUED) == 0 && mSpinner.spin([this]()
+        {
+            std::uint64_t state = mState.load(std::memory_order_relaxed);
+            if(state & QUEUED)
+            {
+                return Spin_Step::Abort;
+            }
+            return (state & WRITER) == 0 && mState.compare_exchange_weak(state, state + READER, std::memory_order_acquire, std::memory_order_relaxed)
+                   ? Spin_Step::Done : Spin_Step::Retry;
         });
+        if(acquired)
+        {
+            return true;
+        }
     }
+    return lock_slow(prioritylvl, Lock_Kind::Shared, deadline);
+}
 
-    std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-    DEBUG_ASSERT(lock_counter == 0);
-    lock_counter++;
-    is_shared_lock = false;
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::lock_upgrade(int prioritylvl)
+{
+    std::uint64_t state = mState.load(std::memory_order_relaxed);
+    bool acquired = false;
+    while(!acquired && (state & (WRITER | UPGRADER | QUEUED)) == 0)
+    {
+        acquired = mState.compare_exchange_weak(state, state + UPGRADER, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+    if(!acquired)
+    {
+        lock_slow(prioritylvl, Lock_Kind::Upgrade, NO_DEADLINE);
+    }
+    mUpgrade_priority = prioritylvl;
 }
 
-void Shared_Priority_Mutex::unlock()
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_upgrade()
 {
-    std::lock_guard<decltype(mMut)> lk(mMut);
-    //Pop from list must be synchronized even if main Mutex lock is shared
-    std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
+    const std::uint64_t prev_state = mState.fetch_sub(UPGRADER, std::memory_order_release);
+    DEBUG_ASSERT((prev_state & UPGRADER) && "Shared_Priority_Mutex::unlock_upgrade: mutex is not locked for upgrade!");
+    if(prev_state & QUEUED)
+    {
+        release_queued();
+    }
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_upgrade_and_lock()
+{
+    std::uint64_t expected = UPGRADER;
+    if(mState.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        return;
+    }
 
-    DEBUG_ASSERT(!lockPriorities.empty() && "PriorityMutex::unlock: priority queue is empty!");
-    lockPriorities.pop();
-    lock_counter--;
-    DEBUG_ASSERT(lock_counter == 0);
-    is_shared_lock = false;
-    mCondV.notify_all();
+    std::unique_lock<decltype(mAdminMut)> admin_lk(mAdminMut);
+    //The last reader to leave sees QUEUED and grants us under mAdminMut
+    mState.fetch_or(QUEUED, std::memory_order_relaxed);
+    if((mState.load(std::memory_order_relaxed) & READER_MASK) == 0)
+    {
+        mState.fetch_sub(UPGRADER - WRITER, std::memory_order_acquire);
+        if(!has_waiters())
+        {
+            mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    Lock_Waiter waiter(mUpgrade_priority);
+    mUpgrading = &waiter;
+    admin_lk.unlock();
+    wait_for_grant(waiter, mSpinner);
+    //The releasing thread already swapped UPGRADER for WRITER
 }
 
-void Shared_Priority_Mutex::lock_shared(int prioritylvl)
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_and_lock_upgrade(int prioritylvl)
 {
-    std::shared_lock<decltype(mMut)> lk(mMut);
+    mUpgrade_priority = prioritylvl;
+    const std::uint64_t prev_state = mState.fetch_add(UPGRADER - WRITER, std::memory_order_release);
+    DEBUG_ASSERT((prev_state & WRITER) && "Shared_Priority_Mutex::unlock_and_lock_upgrade: mutex is not locked exclusively!");
+    if(prev_state & QUEUED)
+    {
+        release_queued();
+    }
+}
 
-    //Push to list must be synchronized even if main Mutex is shared
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_upgrade_and_lock_shared()
+{
+    const std::uint64_t prev_state = mState.fetch_add(READER - UPGRADER, std::memory_order_release);
+    DEBUG_ASSERT((prev_state & UPGRADER) && "Shared_Priority_Mutex::unlock_upgrade_and_lock_shared: mutex is not locked for upgrade!");
+    if(prev_state & QUEUED)
     {
-        std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-        lockPriorities.push(prioritylvl);
+        release_queued();
     }
+}
 
-    while(lockPriorities.top() != prioritylvl)
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::unlock_and_lock_shared()
+{
+    const std::uint64_t prev_state = mState.fetch_add(READER - WRITER, std::memory_order_release);
+    DEBUG_ASSERT((prev_state & WRITER) && "Shared_Priority_Mutex::unlock_and_lock_shared: mutex is not locked exclusively!");
+    if(prev_state & QUEUED)
     {
-        mCondV.wait(lk, [&]{
-            std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-            return (lock_counter == 0 || is_shared_lock)
-                   && (lockPriorities.top() == prioritylvl)
-                   && (lock_counter < MAX_NUM_LOCK_COUNTER); //Do not acquire lock if we are at numeric limit
-        });
+        release_queued();
     }
+}
 
-    //Setting of counter and is_shared_lock must be synchronized even if main mutex is shared
-    std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-    lock_counter++;
-    is_shared_lock = true;
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::release_queued()
+{
+    std::lock_guard<decltype(mAdminMut)> admin_lk(mAdminMut);
+    grant_waiters();
 }
 
-void Shared_Priority_Mutex::unlock_shared()
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::compatible(Lock_Kind kind, std::uint64_t state)
+{
+    switch(kind)
+    {
+    case Lock_Kind::Shared:
+        return (state & WRITER) == 0;
+    case Lock_Kind::Upgrade:
+        return (state & (WRITER | UPGRADER)) == 0;
+    case Lock_Kind::Exclusive:
+        break;
+    }
+    return (state & (WRITER | UPGRADER | READER_MASK)) == 0;
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+std::uint64_t NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::holder_bits(Lock_Kind kind)
+{
+    switch(kind)
+    {
+    case Lock_Kind::Shared:
+        return READER;
+    case Lock_Kind::Upgrade:
+        return UPGRADER;
+    case Lock_Kind::Exclusive:
+        break;
+    }
+    return WRITER;
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::lock_slow(int prioritylvl, Lock_Kind kind, std::chrono::steady_clock::time_point deadline)
 {
-    std::shared_lock<decltype(mMut)> lk(mMut);
-    //Pop from list must be synchronized even if main Mutex lock is shared
-    std::lock_guard<decltype(internal_admin_mutex)> queue_lk(internal_admin_mutex);
-    DEBUG_ASSERT(!lockPriorities.empty() && "PriorityMutex::unlock: priority queue is empty!");
-    lockPriorities.pop();
-    lock_counter--;
-    DEBUG_ASSERT(is_shared_lock);
-    if(lock_counter == 0)
+    std::unique_lock<decltype(mAdminMut)> admin_lk(mAdminMut);
+    //From here on, fast paths fail and every release that may unblock us takes mAdminMut
+    mState.fetch_or(QUEUED, std::memory_order_relaxed);
+    if(try_admit(prioritylvl, kind))
+    {
+        return true;
+    }
+    if(deadline != NO_DEADLINE && std::chrono::steady_clock::now() >= deadline)
+    {
+        if(!has_waiters())
+        {
+            mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    Lock_Waiter waiter(prioritylvl, kind);
+    mWaiters.push(waiter);
+    admin_lk.unlock();
+    if(wait_for_grant(waiter, mSpinner, deadline))
     {
-        is_shared_lock = false;
+        //The releasing thread already added us to mState
+        return true;
     }
 
-    mCondV.notify_all();
+    //Grants happen under mAdminMut, so from here on the waiter is either granted or still queued
+    admin_lk.lock();
+    if(waiter.grant_state.load(std::memory_order_acquire) == Lock_Waiter::GRANTED)
+    {
+        return true;
+    }
+    mWaiters.remove(waiter);
+    //If we were in front, the waiters behind us may be able to join the current lock
+    grant_waiters();
+    return false;
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+bool NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::try_admit(int prioritylvl, Lock_Kind kind)
+{
+    //Waiters keep their place against everything but readers the fairness policy lets join
+    const auto outranked_by = [prioritylvl, kind](const Lock_Waiter *waiter)
+    {
+        if(waiter == nullptr)
+        {
+            return false;
+        }
+        return kind == Lock_Kind::Shared ? !Fairness_Policy::may_join(prioritylvl, waiter->priority) : waiter->priority >= prioritylvl;
+    };
+    if(outranked_by(mWaiters.front()) || outranked_by(mUpgrading))
+    {
+        return false;
+    }
+
+    //QUEUED is set, so mState can only lose holders concurrently
+    if(!compatible(kind, mState.load(std::memory_order_relaxed)))
+    {
+        return false;
+    }
+    mState.fetch_add(holder_bits(kind), std::memory_order_acquire);
+    if(!has_waiters())
+    {
+        mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+template<Supported_Fairness_Policy Fairness_Policy, Supported_Wait_Policy Wait_Policy>
+void NS_detail::Shared_Lock_Core<Fairness_Policy, Wait_Policy>::grant_waiters()
+{
+    if(mUpgrading != nullptr && (mState.load(std::memory_order_relaxed) & READER_MASK) == 0)
+    {
+        Lock_Waiter *const upgrading = mUpgrading;
+        mUpgrading = nullptr;
+        mState.fetch_sub(UPGRADER - WRITER, std::memory_order_acquire);
+        grant(*upgrading);
+    }
+
+    //Grants compatible waiters in queue order. While an upgrade is pending, only readers the fairness policy lets past it join
+    while(Lock_Waiter *const front = mWaiters.front())
+    {
+        if((mUpgrading != nullptr && !Fairness_Policy::may_join(front->priority, mUpgrading->priority))
+           || !compatible(front->kind, mState.load(std::memory_order_relaxed)))
+        {
+            break;
+        }
+        mState.fetch_add(holder_bits(front->kind), std::memory_order_acquire);
+        mWaiters.remove(*front);
+        //The waiter may return and leave its stack frame as soon as it is granted
+        grant(*front);
+    }
+
+    if(!has_waiters())
+    {
+        mState.fetch_and(~QUEUED, std::memory_order_relaxed);
+    }
+}
+
+template class NS_detail::Shared_Lock_Core<Priority_Fairness, Spin_Then_Park>;
+template class NS_detail::Shared_Lock_Core<Priority_Fairness, Park>;
+template class NS_detail::Shared_Lock_Core<Reader_Preference, Spin_Then_Park>;
+template class NS_detail::Shared_Lock_Core<Reader_Preference, Park>;
+template class NS_detail::Shared_Lock_Core<Writer_Preference, Spin_Then_Park>;
+template class NS_detail::Shared_Lock_Core<Writer_Preference, Park>;
+
+
+void Shared_Priority_Mutex::lock(int prioritylvl)
+{
+    mCore.lock_until(prioritylvl, NS_detail::NO_DEADLINE);
+}
+
+void Shared_Priority_Mutex::lock_shared(int prioritylvl)
+{
+    mCore.lock_shared_until(prioritylvl, NS_detail::NO_DEADLINE);
+}
+
+bool Shared_Priority_Mutex::try_lock(int)
+{
+    return mCore.try_lock();
+}
+
+bool Shared_Priority_Mutex::try_lock_shared(int prioritylvl)
+{
+    return mCore.try_lock_shared(prioritylvl);
+}
+
+bool Shared_Priority_Mutex::try_lock_until(std::chrono::steady_clock::time_point deadline, int prioritylvl)
+{
+    return mCore.lock_until(prioritylvl, deadline);
+}
+
+bool Shared_Priority_Mutex::try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int prioritylvl)
+{
+    return mCore.lock_shared_until(prioritylvl, deadline);
+}
+
+void Shared_Priority_Mutex::unlock()
+{
+    mCore.unlock();
+}
+
+void Shared_Priority_Mutex::unlock_shared()
+{
+    mCore.unlock_shared();
+}
+
+void Shared_Priority_Mutex::lock_upgrade(int prioritylvl)
+{
+    mCore.lock_upgrade(prioritylvl);
+}
+
+void Shared_Priority_Mutex::unlock_upgrade()
+{
+    mCore.unlock_upgrade();
+}
+
+void Shared_Priority_Mutex::unlock_upgrade_and_lock()
+{
+    mCore.unlock_upgrade_and_lock();
+}
+
+void Shared_Priority_Mutex::unlock_and_lock_upgrade(int prioritylvl)
+{
+    mCore.unlock_and_lock_upgrade(prioritylvl);
+}
+
+void Shared_Priority_Mutex::unlock_upgrade_and_lock_shared()
+{
+    mCore.unlock_upgrade_and_lock_shared();
+}
+
+void Shared_Priority_Mutex::unlock_and_lock_shared()
+{
+    mCore.unlock_and_lock_shared();
 }
 
 
@@ -95,3 +417,205 @@ void Biased_Shared_Priority_Mutex::lock_shared(int prioritylvl)
 {
     Shared_Priority_Mutex::lock_shared(prioritylvl - mBias);
 }
+
+void Biased_Shared_Priority_Mutex::lock_upgrade(int priorityLvl)
+{
+    Shared_Priority_Mutex::lock_upgrade(priorityLvl + mBias);
+}
+
+void Biased_Shared_Priority_Mutex::unlock_and_lock_upgrade(int priorityLvl)
+{
+    Shared_Priority_Mutex::unlock_and_lock_upgrade(priorityLvl + mBias);
+}
+
+bool Biased_Shared_Priority_Mutex::try_lock(int priorityLvl)
+{
+    return Shared_Priority_Mutex::try_lock(priorityLvl + mBias);
+}
+
+bool Biased_Shared_Priority_Mutex::try_lock_shared(int prioritylvl)
+{
+    return Shared_Priority_Mutex::try_lock_shared(prioritylvl - mBias);
+}
+
+bool Biased_Shared_Priority_Mutex::try_lock_until(std::chrono::steady_clock::time_point deadline, int priorityLvl)
+{
+    return Shared_Priority_Mutex::try_lock_until(deadline, priorityLvl + mBias);
+}
+
+bool Biased_Shared_Priority_Mutex::try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int prioritylvl)
+{
+    return Shared_Priority_Mutex::try_lock_shared_until(deadline, prioritylvl - mBias);
+}
+
+
+Distributed_Shared_Priority_Mutex::Distributed_Shared_Priority_Mutex(const Spin_Config &spin_config)
+    : Shared_Priority_Mutex(spin_config)
+{
+    const std::size_t num_slots = std::bit_ceil(std::max(1u, std::thread::hardware_concurrency()));
+    mSlots = std::make_unique<Reader_Slot[]>(num_slots);
+    mSlot_mask = num_slots - 1;
+}
+
+void Distributed_Shared_Priority_Mutex::lock(int priorityLvl)
+{
+    Shared_Priority_Mutex::lock(priorityLvl);
+    revoke_bias(NS_detail::NO_DEADLINE);
+}
+
+bool Distributed_Shared_Priority_Mutex::try_lock(int priorityLvl)
+{
+    if(!Shared_Priority_Mutex::try_lock(priorityLvl))
+    {
+        return false;
+    }
+    //Fails unless the slots are already drained
+    if(!revoke_bias(std::chrono::steady_clock::time_point::min()))
+    {
+        Shared_Priority_Mutex::unlock();
+        return false;
+    }
+    return true;
+}
+
+bool Distributed_Shared_Priority_Mutex::try_lock_until(std::chrono::steady_clock::time_point deadline, int priorityLvl)
+{
+    if(!Shared_Priority_Mutex::try_lock_until(deadline, priorityLvl))
+    {
+        return false;
+    }
+    if(!revoke_bias(deadline))
+    {
+        Shared_Priority_Mutex::unlock();
+        return false;
+    }
+    return true;
+}
+
+void Distributed_Shared_Priority_Mutex::lock_shared(int priorityLvl)
+{
+    if(try_lock_fast_shared())
+    {
+        return;
+    }
+    Shared_Priority_Mutex::lock_shared(priorityLvl);
+    rebias();
+}
+
+bool Distributed_Shared_Priority_Mutex::try_lock_shared(int priorityLvl)
+{
+    if(try_lock_fast_shared())
+    {
+        return true;
+    }
+    if(!Shared_Priority_Mutex::try_lock_shared(priorityLvl))
+    {
+        return false;
+    }
+    rebias();
+    return true;
+}
+
+bool Distributed_Shared_Priority_Mutex::try_lock_shared_until(std::chrono::steady_clock::time_point deadline, int priorityLvl)
+{
+    if(try_lock_fast_shared())
+    {
+        return true;
+    }
+    if(!Shared_Priority_Mutex::try_lock_shared_until(deadline, priorityLvl))
+    {
+        return false;
+    }
+    rebias();
+    return true;
+}
+
+void Distributed_Shared_Priority_Mutex::unlock_shared()
+{
+    //unlock_shared() cannot tell a fast from a slow read lock of this thread. Any decrement of the own slot or
+    //of the underlying lock releases one reader, and each count only drops as far as the readers it holds,
+    //so a writer still only gets in after every reader has left
+    Reader_Slot &slot = own_slot();
+    std::uint32_t count = slot.count.load(std::memory_order_relaxed);
+    while(count != 0)
+    {
+        if(slot.count.compare_exchange_weak(count, count - 1, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+    Shared_Priority_Mutex::unlock_shared();
+}
+
+void Distributed_Shared_Priority_Mutex::unlock_upgrade_and_lock()
+{
+    Shared_Priority_Mutex::unlock_upgrade_and_lock();
+    revoke_bias(NS_detail::NO_DEADLINE);
+}
+
+Distributed_Shared_Priority_Mutex::Reader_Slot& Distributed_Shared_Priority_Mutex::own_slot() const noexcept
+{
+    return mSlots[tl_reader_idx & mSlot_mask];
+}
+
+bool Distributed_Shared_Priority_Mutex::try_lock_fast_shared()
+{
+    if(!mRead_bias.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    Reader_Slot &slot = own_slot();
+    //seq_cst pairs with revoke_bias(): either the writer sees our slot, or we see the revoked bias
+    slot.count.fetch_add(1, std::memory_order_seq_cst);
+    if(mRead_bias.load(std::memory_order_seq_cst))
+    {
+        return true;
+    }
+
+    std::uint32_t count = slot.count.load(std::memory_order_relaxed);
+    while(count != 0)
+    {
+        if(slot.count.compare_exchange_weak(count, count - 1, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return false;
+        }
+    }
+    //A slow reader of the same slot released with our increment, its unit of the underlying lock is ours now
+    return true;
+}
+
+bool Distributed_Shared_Priority_Mutex::revoke_bias(std::chrono::steady_clock::time_point deadline)
+{
+    if(!mRead_bias.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mRead_bias.store(false, std::memory_order_seq_cst);
+    for(std::size_t slot_idx = 0; slot_idx <= mSlot_mask; ++slot_idx)
+    {
+        while(mSlots[slot_idx].count.load(std::memory_order_seq_cst) != 0)
+        {
+            if(std::chrono::steady_clock::now() >= deadline)
+            {
+                //Fast readers are still inside. Without the bias, the next writer would not wait for them
+                mRead_bias.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    mInhibit_until.store((end + (end - start) * REBIAS_FACTOR).time_since_epoch().count(), std::memory_order_relaxed);
+    return true;
+}
+
+void Distributed_Shared_Priority_Mutex::rebias()
+{
+    //No writer can hold the lock now, so it is safe to let readers bypass it again
+    if(!mRead_bias.load(std::memory_order_relaxed)
+       && std::chrono::steady_clock::now().time_since_epoch().count() >= mInhibit_until.load(std::memory_order_relaxed))
+    {
+        mRead_bias.store(true, std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,36 @@
+#include "benchmarks.h"
+
+#include <cstdlib>
+#include <new>
+
+//Replaces the global allocation functions to count allocations of the whole process
+
+namespace
+{
+std::atomic<std::size_t> g_allocation_count{0};
+}
+
+std::size_t NS_bench::allocation_count()
+{
+    return g_allocation_count.load();
+}
+
+void* operator new(std::size_t size)
+{
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,70 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <DTools/concurrency/Parallel_Algorithms.h>
+
+using namespace NS_dtools::NS_concurrency;
+
+namespace
+{
+
+constexpr std::size_t NUM_ELEMENTS = 4000000;
+
+void print_result(const char *name, double pool_ns, double std_par_ns)
+{
+    std::cout << "  " << name << ": " << pool_ns / NUM_ELEMENTS << " ns/element, std::execution::par "
+              << std_par_ns / NUM_ELEMENTS << " ns/element\n";
+}
+
+}
+
+void NS_bench::bench_parallel_algorithms()
+{
+    std::cout << "Parallel algorithms on " << NUM_ELEMENTS << " elements:\n";
+    Thread_Pool pool(std::thread::hardware_concurrency());
+    std::mt19937_64 rng(42);
+    std::vector<double> values(NUM_ELEMENTS);
+    for(double &val : values)
+    {
+        val = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
+    std::vector<double> results(NUM_ELEMENTS);
+    const auto heavy = [](double val){ return std::sqrt(val) * std::sin(val) + std::cos(val); };
+
+    //Warm up both, the first run of either pays for starting its threads
+    parallel_transform(pool, values.begin(), values.end(), results.begin(), heavy);
+    std::transform(std::execution::par, values.begin(), values.end(), results.begin(), heavy);
+
+    print_result("transform",
+                 measure_ns([&](){ parallel_transform(pool, values.begin(), values.end(), results.begin(), heavy); }),
+                 measure_ns([&](){ std::transform(std::execution::par, values.begin(), values.end(), results.begin(), heavy); }));
+
+    double sink = 0.0;
+    print_result("reduce",
+                 measure_ns([&](){ sink += parallel_reduce(pool, values.begin(), values.end(), 0.0); }),
+                 measure_ns([&](){ sink += std::reduce(std::execution::par, values.begin(), values.end(), 0.0); }));
+
+    print_result("inclusive scan",
+                 measure_ns([&](){ parallel_scan(pool, values.begin(), values.end(), results.begin()); }),
+                 measure_ns([&](){ std::inclusive_scan(std::execution::par, values.begin(), values.end(), results.begin()); }));
+
+    std::vector<double> to_sort = values;
+    const double pool_sort_ns = measure_ns([&](){ parallel_sort(pool, to_sort.begin(), to_sort.end()); });
+    to_sort = values;
+    const double std_sort_ns = measure_ns([&](){ std::sort(std::execution::par, to_sort.begin(), to_sort.end()); });
+    print_result("sort", pool_sort_ns, std_sort_ns);
+
+    if(sink < 0.0)
+    {
+        std::cout << sink << '\n';
+    }
+}
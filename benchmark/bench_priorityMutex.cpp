@@ -0,0 +1,192 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <DTools/concurrency/PriorityMutex.h>
+
+using namespace NS_dtools::NS_concurrency::NS_priority_mutex;
+
+namespace
+{
+
+constexpr int LOCKS_PER_THREAD = 200000;
+constexpr int HANDOFFS_PER_THREAD = 1000;
+//How long the owner holds the mutex after the other thread announced itself, so that it is spinning or parked in lock()
+constexpr std::chrono::microseconds HANDOFF_HOLD_TIME{50};
+
+struct Latency
+{
+    double median_ns;
+    double p99_ns;
+};
+
+//Throughput: ns per lock/unlock pair while all threads hammer the mutex with a tiny critical section
+template<typename Mutex, typename Lock_Fn, typename Unlock_Fn, typename Section_Fn>
+double contended_ns(Mutex &mut, std::size_t num_threads, Lock_Fn lock_fn, Unlock_Fn unlock_fn, Section_Fn section_fn)
+{
+    const double total_ns = NS_bench::measure_ns([&]()
+    {
+        std::vector<std::thread> threads;
+        for(std::size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+        {
+            threads.emplace_back([&]()
+            {
+                for(int i = 0; i < LOCKS_PER_THREAD; ++i)
+                {
+                    lock_fn(mut);
+                    section_fn();
+                    unlock_fn(mut);
+                }
+            });
+        }
+        for(std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    });
+    return total_ns / static_cast<double>(num_threads * LOCKS_PER_THREAD);
+}
+
+//Two threads hand the mutex back and forth. Measures from unlock() in the owner until the thread blocked in lock() returns from it.
+template<typename Mutex>
+Latency handoff_latency(Mutex &mut)
+{
+    const auto now_ns = []()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    std::atomic<std::int64_t> unlock_time{0};
+    std::atomic<int> announced_waiters{0}; //Handoff n may happen once the n+1-th waiter announced itself
+    std::atomic_bool first_owner_holds{false};
+
+    const auto hand_over = [&](int handoff_idx)
+    {
+        while(announced_waiters.load() <= handoff_idx)
+        {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(HANDOFF_HOLD_TIME);
+        unlock_time.store(now_ns(), std::memory_order_relaxed);
+        mut.unlock();
+    };
+    const auto take_over = [&](std::vector<std::int64_t> &OUT_latencies)
+    {
+        announced_waiters.fetch_add(1);
+        mut.lock();
+        OUT_latencies.push_back(now_ns() - unlock_time.load(std::memory_order_relaxed));
+    };
+
+    std::vector<std::int64_t> first_latencies, second_latencies;
+    std::thread first([&]()
+    {
+        mut.lock();
+        first_owner_holds = true;
+        for(int i = 0; i < HANDOFFS_PER_THREAD; ++i)
+        {
+            hand_over(2 * i);
+            take_over(first_latencies);
+        }
+        mut.unlock();
+    });
+    std::thread second([&]()
+    {
+        while(!first_owner_holds)
+        {
+            std::this_thread::yield();
+        }
+        for(int i = 0; i < HANDOFFS_PER_THREAD; ++i)
+        {
+            take_over(second_latencies);
+            hand_over(2 * i + 1);
+        }
+    });
+    first.join();
+    second.join();
+
+    std::vector<std::int64_t> latencies = std::move(first_latencies);
+    latencies.insert(latencies.end(), second_latencies.begin(), second_latencies.end());
+    std::sort(latencies.begin(), latencies.end());
+    return {static_cast<double>(latencies[latencies.size() / 2]), static_cast<double>(latencies[latencies.size() * 99 / 100])};
+}
+
+template<typename Mutex>
+void print_handoff_latency(const char *name, Mutex &mut)
+{
+    const Latency latency = handoff_latency(mut);
+    std::cout << "  " << name << ": median " << latency.median_ns << " ns, p99 " << latency.p99_ns << " ns\n";
+}
+
+template<typename Mutex>
+double exclusive_ns(Mutex &mut, std::size_t num_threads)
+{
+    long counter = 0;
+    return contended_ns(mut, num_threads, [](Mutex &mut){ mut.lock(); }, [](Mutex &mut){ mut.unlock(); }, [&counter](){ ++counter; });
+}
+
+template<typename Mutex>
+double shared_ns(Mutex &mut, std::size_t num_threads)
+{
+    const long value = 0;
+    return contended_ns(mut, num_threads, [](Mutex &mut){ mut.lock_shared(); }, [](Mutex &mut){ mut.unlock_shared(); },
+                        [&value](){ [[maybe_unused]] volatile long copy = value; });
+}
+
+}
+
+void NS_bench::bench_priority_mutex()
+{
+    const std::size_t num_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::cout << "Priority mutexes, " << num_threads << " threads with a tiny critical section:\n";
+
+    std::mutex std_mut;
+    std::cout << "  std::mutex: " << exclusive_ns(std_mut, num_threads) << " ns/lock\n";
+
+    Priority_Mutex parking_mut(Spin_Config{0, false});
+    std::cout << "  Priority_Mutex, no spinning: " << exclusive_ns(parking_mut, num_threads) << " ns/lock\n";
+
+    Priority_Mutex fixed_mut(Spin_Config{Spin_Config::DEFAULT_MAX_SPINS, false});
+    std::cout << "  Priority_Mutex, fixed spinning: " << exclusive_ns(fixed_mut, num_threads) << " ns/lock\n";
+
+    Priority_Mutex adaptive_mut;
+    const double adaptive_ns = exclusive_ns(adaptive_mut, num_threads);
+    std::cout << "  Priority_Mutex, adaptive spinning: " << adaptive_ns << " ns/lock (learned budget " << adaptive_mut.spin_budget() << ")\n";
+
+    Shared_Priority_Mutex shared_parking_mut(Spin_Config{0, false});
+    std::cout << "  Shared_Priority_Mutex, no spinning: " << exclusive_ns(shared_parking_mut, num_threads) << " ns/lock\n";
+
+    Shared_Priority_Mutex shared_adaptive_mut;
+    std::cout << "  Shared_Priority_Mutex, adaptive spinning: " << exclusive_ns(shared_adaptive_mut, num_threads) << " ns/lock\n";
+
+    Shared_Priority_Mutex virtual_mut;
+    Basic_Shared_Priority_Mutex<> static_mut;
+    std::cout << "  Uncontended lock/unlock: Shared_Priority_Mutex " << exclusive_ns(virtual_mut, 1)
+              << " ns, Basic_Shared_Priority_Mutex " << exclusive_ns(static_mut, 1) << " ns\n";
+
+    std::cout << "Read locks per thread count:\n";
+    for(std::size_t readers = 1; readers <= num_threads; readers *= 2)
+    {
+        Shared_Priority_Mutex shared_mut;
+        Distributed_Shared_Priority_Mutex distributed_mut;
+        std::cout << "  " << readers << " readers: Shared_Priority_Mutex " << shared_ns(shared_mut, readers)
+                  << " ns/lock, Distributed_Shared_Priority_Mutex " << shared_ns(distributed_mut, readers) << " ns/lock\n";
+    }
+
+    std::cout << "Handoff latency, from unlock() until the thread waiting in lock() returns from it:\n";
+    std::mutex handoff_std_mut;
+    print_handoff_latency("std::mutex", handoff_std_mut);
+    Priority_Mutex handoff_parking_mut(Spin_Config{0, false});
+    print_handoff_latency("Priority_Mutex, no spinning", handoff_parking_mut);
+    Priority_Mutex handoff_fixed_mut(Spin_Config{Spin_Config::DEFAULT_MAX_SPINS, false});
+    print_handoff_latency("Priority_Mutex, fixed spinning", handoff_fixed_mut);
+    Priority_Mutex handoff_adaptive_mut;
+    print_handoff_latency("Priority_Mutex, adaptive spinning", handoff_adaptive_mut);
+    Shared_Priority_Mutex handoff_shared_mut;
+    print_handoff_latency("Shared_Priority_Mutex, adaptive spinning", handoff_shared_mut);
+}
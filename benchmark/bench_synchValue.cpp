@@ -0,0 +1,100 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <DTools/concurrency/Synch_Value.h>
+#include <DTools/concurrency/Thread_Pool.h>
+
+using namespace NS_dtools::NS_concurrency;
+
+namespace
+{
+
+constexpr int GETS_PER_THREAD = 200000;
+constexpr int ASYNC_SETS = 100000;
+
+//Keeps the compiler from dropping a get() whose result is unused
+long touch(long val) { return val; }
+long touch(const std::vector<long> &vec) { return static_cast<long>(vec.size()); }
+
+//ns per read_fn() while num_threads readers run at the same time
+template<typename Read_Fn>
+double read_ns(std::size_t num_threads, Read_Fn read_fn)
+{
+    const double total_ns = NS_bench::measure_ns([&]()
+    {
+        std::vector<std::thread> threads;
+        for(std::size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+        {
+            threads.emplace_back([&]()
+            {
+                for(int i = 0; i < GETS_PER_THREAD; ++i)
+                {
+                    [[maybe_unused]] volatile long sink = read_fn();
+                }
+            });
+        }
+        for(std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    });
+    return total_ns / static_cast<double>(num_threads * GETS_PER_THREAD);
+}
+
+//ns per setAsync() in a burst, until the last value is visible
+double set_async_ns(Thread_Pool &pool, int mode)
+{
+    Synch_Value<long> val(0, mode, ASYNC_SETS);
+    return NS_bench::measure_ns([&]()
+    {
+        for(long i = 1; i <= ASYNC_SETS; ++i)
+        {
+            val.setAsync(pool, i);
+        }
+        val.set(0L); //Waits for all async sets
+    }) / ASYNC_SETS;
+}
+
+template<typename T>
+double get_ns(Synch_Value<T> &val, std::size_t num_threads)
+{
+    return read_ns(num_threads, [&val](){ return touch(val.get()); });
+}
+
+template<typename T>
+double visit_ns(Synch_Value<T> &val, std::size_t num_threads)
+{
+    return read_ns(num_threads, [&val](){ return val.visit([](const T &value){ return touch(value); }); });
+}
+
+}
+
+void NS_bench::bench_synch_value()
+{
+    const std::size_t num_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::cout << "Synch_Value reads per reader count:\n";
+    for(std::size_t readers = 1; readers <= num_threads; readers *= 2)
+    {
+        Synch_Value<long> locked_val(0);
+        Synch_Value<long> seqlock_val(0, LOCKFREEREAD);
+        Synch_Value<std::vector<long>> locked_vec(std::vector<long>(512));
+        Synch_Value<std::vector<long>> snapshot_vec(std::vector<long>(512), LOCKFREEREAD);
+        std::cout << "  " << readers << " readers: long locked " << get_ns(locked_val, readers)
+                  << " ns, long seqlock " << get_ns(seqlock_val, readers)
+                  << " ns, 4KB vector locked " << get_ns(locked_vec, readers)
+                  << " ns, 4KB vector snapshot " << get_ns(snapshot_vec, readers)
+                  << " ns, 4KB vector visit() locked " << visit_ns(locked_vec, readers)
+                  << " ns, 4KB vector visit() snapshot " << visit_ns(snapshot_vec, readers) << " ns\n";
+    }
+}
+
+void NS_bench::bench_synch_value_async()
+{
+    Thread_Pool pool(std::max(2u, std::thread::hardware_concurrency()));
+    std::cout << "Synch_Value::setAsync() burst of " << ASYNC_SETS << " on Thread_Pool: merged " << set_async_ns(pool, 0x0)
+              << " ns/set, UPDATEINORDER " << set_async_ns(pool, UPDATEINORDER) << " ns/set\n";
+}
@@ -0,0 +1,129 @@
+#include "benchmarks.h"
+
+#include <array>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include <DTools/concurrency/Thread_Pool.h>
+
+using namespace NS_dtools::NS_concurrency;
+
+namespace
+{
+
+constexpr std::size_t NUM_POSTS = 100000;
+
+void report(const char *name, std::size_t num_allocs, double elapsed_ns)
+{
+    std::cout << "  " << name << ": "
+              << static_cast<double>(num_allocs) / NUM_POSTS << " allocations/post, "
+              << elapsed_ns / NUM_POSTS << " ns/post\n";
+}
+
+//Reproduces the wrapping done per post() before the pool got its own task type:
+//std::bind -> capturing lambda -> std::packaged_task -> type erasure of the executor queue
+void bench_legacy_wrapping()
+{
+    std::atomic_int sink{0};
+    const std::size_t allocs_before = NS_bench::allocation_count();
+    const double elapsed_ns = NS_bench::measure_ns([&sink]()
+    {
+        for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+        {
+            auto bound_functor = std::bind([&sink](int val){ sink += val; return val; }, 1);
+            auto task_wrapper = [bound_functor=std::move(bound_functor)]() -> int { return bound_functor(); };
+            std::packaged_task<int()> task(task_wrapper);
+            std::future<int> fut = task.get_future();
+            std::move_only_function<void()> erased_task(std::move(task));
+            erased_task();
+            fut.get();
+        }
+    });
+    report("legacy wrapping (before)", NS_bench::allocation_count() - allocs_before, elapsed_ns);
+}
+
+void bench_post_free()
+{
+    Thread_Pool pool(1);
+    std::atomic_int sink{0};
+    //Warm up, so that the worker deques have grown to their steady state size
+    for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+    {
+        pool.post_free([&sink](int val){ sink += val; }, 1);
+    }
+    pool.wait_for_tasks_done();
+
+    const std::size_t allocs_before = NS_bench::allocation_count();
+    const double elapsed_ns = NS_bench::measure_ns([&]()
+    {
+        for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+        {
+            pool.post_free([&sink](int val){ sink += val; }, 1);
+        }
+        pool.wait_for_tasks_done();
+    });
+    report("post_free, small capture", NS_bench::allocation_count() - allocs_before, elapsed_ns);
+}
+
+void bench_post_free_large_capture()
+{
+    Thread_Pool pool(1);
+    std::atomic_int sink{0};
+    std::array<char, 2 * Pool_Task::INLINE_CAPACITY> payload{};
+    for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+    {
+        pool.post_free([&sink, payload](){ sink += payload[0]; });
+    }
+    pool.wait_for_tasks_done();
+
+    const std::size_t allocs_before = NS_bench::allocation_count();
+    const double elapsed_ns = NS_bench::measure_ns([&]()
+    {
+        for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+        {
+            pool.post_free([&sink, payload](){ sink += payload[0]; });
+        }
+        pool.wait_for_tasks_done();
+    });
+    report("post_free, capture > inline capacity", NS_bench::allocation_count() - allocs_before, elapsed_ns);
+}
+
+void bench_post()
+{
+    Thread_Pool pool(1);
+    std::vector<std::future<int>> futures;
+    futures.reserve(NUM_POSTS);
+    for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+    {
+        futures.push_back(pool.post([](int val){ return val; }, 1));
+    }
+    pool.wait_for_tasks_done();
+    futures.clear();
+
+    const std::size_t allocs_before = NS_bench::allocation_count();
+    const double elapsed_ns = NS_bench::measure_ns([&]()
+    {
+        for(std::size_t post_idx = 0; post_idx < NUM_POSTS; ++post_idx)
+        {
+            futures.push_back(pool.post([](int val){ return val; }, 1));
+        }
+        for(auto &fut : futures)
+        {
+            fut.get();
+        }
+    });
+    report("post with future (std::promise state)", NS_bench::allocation_count() - allocs_before, elapsed_ns);
+}
+
+}
+
+void NS_bench::bench_thread_pool_alloc()
+{
+    std::cout << "Thread_Pool allocations per post (" << NUM_POSTS << " posts):\n";
+    bench_legacy_wrapping();
+    bench_post_free();
+    bench_post_free_large_capture();
+    bench_post();
+}
@@ -0,0 +1,55 @@
+#include "benchmarks.h"
+
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <DTools/concurrency/Thread_Pool.h>
+
+using namespace NS_dtools::NS_concurrency;
+
+namespace
+{
+
+constexpr std::size_t NUM_ELEMENTS = 1000000;
+
+}
+
+void NS_bench::bench_thread_pool_bulk()
+{
+    std::cout << "Thread_Pool submission of " << NUM_ELEMENTS << " elements:\n";
+    Thread_Pool pool(std::thread::hardware_concurrency());
+    std::vector<int> values(NUM_ELEMENTS, 1);
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(NUM_ELEMENTS);
+    const double loop_ns = measure_ns([&]()
+    {
+        for(std::size_t elem_idx = 0; elem_idx < NUM_ELEMENTS; ++elem_idx)
+        {
+            futures.push_back(pool.post([&values, elem_idx](){ values[elem_idx] += 1; }));
+        }
+        for(auto &fut : futures)
+        {
+            fut.get();
+        }
+    });
+    std::cout << "  post() per element: " << loop_ns / NUM_ELEMENTS << " ns/element\n";
+
+    //Warm up once, the first bulk submissions after the post() loop are dominated by allocator cleanup
+    pool.post_bulk(values, [](int &val){ val += 1; }).get();
+    pool.parallel_for<std::size_t>(0, NUM_ELEMENTS, 4096, [&values](std::size_t elem_idx){ values[elem_idx] += 1; }).get();
+
+    const double bulk_ns = measure_ns([&]()
+    {
+        pool.post_bulk(values, [](int &val){ val += 1; }).get();
+    });
+    std::cout << "  post_bulk(): " << bulk_ns / NUM_ELEMENTS << " ns/element\n";
+
+    const double parallel_for_ns = measure_ns([&]()
+    {
+        pool.parallel_for<std::size_t>(0, NUM_ELEMENTS, 4096, [&values](std::size_t elem_idx){ values[elem_idx] += 1; }).get();
+    });
+    std::cout << "  parallel_for(grain 4096): " << parallel_for_ns / NUM_ELEMENTS << " ns/element\n";
+}
@@ -0,0 +1,33 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/*Micro-benchmarks for DTLib. Each one prints its own results to stdout.*/
+
+namespace NS_bench
+{
+
+//Number of calls to the global operator new since program start (see alloc_counter.cpp)
+[[nodiscard]] std::size_t allocation_count();
+
+template<typename Functor>
+[[nodiscard]] double measure_ns(Functor &&f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void bench_thread_pool_alloc();
+void bench_thread_pool_bulk();
+void bench_parallel_algorithms();
+void bench_priority_mutex();
+void bench_synch_value();
+void bench_synch_value_async();
+
+} //NS_bench
+
+#endif // BENCHMARKS_H
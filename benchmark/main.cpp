@@ -0,0 +1,12 @@
+#include "benchmarks.h"
+
+int main()
+{
+    NS_bench::bench_thread_pool_alloc();
+    NS_bench::bench_thread_pool_bulk();
+    NS_bench::bench_parallel_algorithms();
+    NS_bench::bench_priority_mutex();
+    NS_bench::bench_synch_value();
+    NS_bench::bench_synch_value_async();
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <DTools/concurrency/Lazy_Task.h>
+#include <DTools/concurrency/Thread_Pool.h>
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+namespace
+{
+
+Lazy_Task<int> add_on_pool(Thread_Pool &pool, int lhs, int rhs)
+{
+    co_await pool.schedule();
+    co_return lhs + rhs;
+}
+
+Lazy_Task<int> chained_sum(Thread_Pool &pool, int depth)
+{
+    int sum = 0;
+    for(int step = 0; step < depth; ++step)
+    {
+        sum = co_await add_on_pool(pool, sum, 1);
+    }
+    co_return sum;
+}
+
+Lazy_Task<void> throw_on_pool(Thread_Pool &pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error("coroutine failed");
+}
+
+Lazy_Task<std::unique_ptr<int>> make_unique_on_pool(Thread_Pool &pool)
+{
+    co_await pool.schedule();
+    co_return std::make_unique<int>(7);
+}
+
+}
+
+TEST(LAZYTASK, ScheduleResumesOnPoolThread)
+{
+    Thread_Pool pool(2);
+    const std::thread::id caller_id = std::this_thread::get_id();
+    auto coro = [](Thread_Pool &pool) -> Lazy_Task<std::thread::id>
+    {
+        co_await pool.schedule();
+        co_return std::this_thread::get_id();
+    };
+    ASSERT_NE(sync_wait(coro(pool)), caller_id);
+}
+
+TEST(LAZYTASK, TaskIsLazy)
+{
+    bool started = false;
+    auto coro = [](bool &started) -> Lazy_Task<void>
+    {
+        started = true;
+        co_return;
+    };
+    Lazy_Task<void> task = coro(started);
+    ASSERT_FALSE(started);
+    sync_wait(std::move(task));
+    ASSERT_TRUE(started);
+}
+
+TEST(LAZYTASK, LongChainDoesNotBlockWorkers)
+{
+    Thread_Pool pool(1);
+    ASSERT_EQ(sync_wait(chained_sum(pool, 10000)), 10000);
+}
+
+TEST(LAZYTASK, ExceptionPropagatesToAwaiter)
+{
+    Thread_Pool pool(2);
+    ASSERT_THROW(sync_wait(throw_on_pool(pool)), std::runtime_error);
+}
+
+TEST(LAZYTASK, MoveOnlyResult)
+{
+    Thread_Pool pool(2);
+    std::unique_ptr<int> result = sync_wait(make_unique_on_pool(pool));
+    ASSERT_EQ(*result, 7);
+}
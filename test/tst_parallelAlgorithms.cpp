@@ -0,0 +1,116 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+#include <string>
+
+#include <DTools/concurrency/Parallel_Algorithms.h>
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+namespace
+{
+std::vector<int> random_values(std::size_t size, int max_value)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> dist(0, max_value);
+    std::vector<int> values(size);
+    for(int &value : values)
+    {
+        value = dist(rng);
+    }
+    return values;
+}
+}
+
+TEST(PARALLELALGORITHMS, ForEachAndTransform)
+{
+    Thread_Pool pool(4);
+    std::vector<int> values(100000, 1);
+    parallel_for_each(pool, values.begin(), values.end(), [](int &value){ value += 1; });
+    std::vector<long long> squares(values.size());
+    auto out_end = parallel_transform(pool, values.begin(), values.end(), squares.begin(), [](int value){ return 1LL * value * value; });
+    ASSERT_EQ(out_end, squares.end());
+    ASSERT_EQ(std::accumulate(squares.begin(), squares.end(), 0LL), 400000);
+}
+
+TEST(PARALLELALGORITHMS, ReduceMatchesSequential)
+{
+    Thread_Pool pool(4);
+    const std::vector<int> values = random_values(1000003, 1000);
+    const long long expected = std::accumulate(values.begin(), values.end(), 7LL);
+    ASSERT_EQ(parallel_reduce(pool, values.begin(), values.end(), 7LL), expected);
+    ASSERT_EQ(parallel_reduce(pool, values.begin(), values.begin(), 7LL), 7);
+    ASSERT_EQ(parallel_reduce(pool, values.begin(), values.end(), 0, [](int lhs, int rhs){ return std::max(lhs, rhs); }),
+              *std::max_element(values.begin(), values.end()));
+}
+
+TEST(PARALLELALGORITHMS, ScanMatchesSequential)
+{
+    Thread_Pool pool(3);
+    std::vector<long long> values(500001);
+    std::iota(values.begin(), values.end(), 0);
+    std::vector<long long> expected(values.size());
+    std::inclusive_scan(values.begin(), values.end(), expected.begin());
+
+    std::vector<long long> scanned(values.size());
+    parallel_scan(pool, values.begin(), values.end(), scanned.begin());
+    ASSERT_EQ(scanned, expected);
+
+    //Non-commutative op, in place
+    std::vector<std::string> words(20000, "a");
+    words[0] = "b";
+    parallel_scan(pool, words.begin(), words.end(), words.begin(), [](const std::string &lhs, const std::string &rhs){ return lhs.substr(0, 1) + rhs; });
+    ASSERT_EQ(words.back(), "ba");
+}
+
+TEST(PARALLELALGORITHMS, SortMatchesStdSort)
+{
+    Thread_Pool pool(4);
+    for(std::size_t size : {0u, 1u, 5000u, 100000u, 1000001u})
+    {
+        std::vector<int> values = random_values(size, 1000);
+        std::vector<int> expected = values;
+        std::sort(expected.begin(), expected.end());
+        parallel_sort(pool, values.begin(), values.end());
+        ASSERT_EQ(values, expected);
+    }
+
+    std::vector<std::string> words;
+    for(int value : random_values(50000, 100000))
+    {
+        words.push_back(std::to_string(value));
+    }
+    std::vector<std::string> expected_words = words;
+    std::sort(expected_words.begin(), expected_words.end(), std::greater<>());
+    parallel_sort(pool, words.begin(), words.end(), std::greater<>());
+    ASSERT_EQ(words, expected_words);
+}
+
+TEST(PARALLELALGORITHMS, ExceptionIsRethrownAfterAllPieces)
+{
+    Thread_Pool pool(4);
+    std::vector<int> values(100000, 0);
+    ASSERT_THROW(parallel_for_each(pool, values.begin(), values.end(), [](int &value)
+    {
+        if(value == 0)
+        {
+            throw std::runtime_error("element failed");
+        }
+    }), std::runtime_error);
+}
+
+TEST(PARALLELALGORITHMS, CallableFromWithinPoolTask)
+{
+    Thread_Pool pool(2);
+    auto fut = pool.post([&pool]()
+    {
+        std::vector<int> values = random_values(200000, 100);
+        parallel_sort(pool, values.begin(), values.end());
+        return std::is_sorted(values.begin(), values.end());
+    });
+    ASSERT_TRUE(fut.get());
+}
@@ -0,0 +1,96 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <DTools/concurrency/Pool_Future.h>
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+TEST(POOLFUTURE, ThenChainsOnPool)
+{
+    Thread_Pool pool(2);
+    auto fut = post_async(pool, [](int val){ return val + 1; }, 1)
+                   .then([](int val){ return val * 10; })
+                   .then([](int val){ return std::to_string(val); });
+    ASSERT_EQ(fut.get(), "20");
+}
+
+TEST(POOLFUTURE, ThenRunsWhenPromiseIsSetLater)
+{
+    Thread_Pool pool(2);
+    Pool_Promise<int> promise(pool);
+    std::atomic_bool ran{false};
+    auto fut = promise.get_future().then([&ran](int val){ ran = true; return val; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_FALSE(ran);
+    promise.set_value(7);
+    ASSERT_EQ(fut.get(), 7);
+    ASSERT_TRUE(ran);
+}
+
+TEST(POOLFUTURE, ExceptionSkipsContinuations)
+{
+    Thread_Pool pool(2);
+    std::atomic_bool ran{false};
+    auto fut = post_async(pool, [](){ throw std::runtime_error("task failed"); })
+                   .then([&ran](){ ran = true; });
+    ASSERT_THROW(fut.get(), std::runtime_error);
+    ASSERT_FALSE(ran);
+}
+
+TEST(POOLFUTURE, BrokenPromise)
+{
+    Thread_Pool pool(1);
+    Pool_Future<int> fut;
+    {
+        Pool_Promise<int> promise(pool);
+        fut = promise.get_future();
+    }
+    ASSERT_THROW(fut.get(), std::future_error);
+}
+
+TEST(POOLFUTURE, WhenAllCollectsInOrder)
+{
+    Thread_Pool pool(4);
+    std::vector<Pool_Future<int>> futures;
+    for(int i = 0; i < 20; ++i)
+    {
+        futures.push_back(post_async(pool, [i](){ return i * i; }));
+    }
+    std::vector<int> results = when_all(std::move(futures)).get();
+    ASSERT_EQ(results.size(), 20);
+    for(int i = 0; i < 20; ++i)
+    {
+        ASSERT_EQ(results[i], i * i);
+    }
+
+    auto tuple_fut = when_all(post_async(pool, [](){ return 1; }), post_async(pool, [](){ return std::string("two"); }));
+    auto [one, two] = tuple_fut.get();
+    ASSERT_EQ(one, 1);
+    ASSERT_EQ(two, "two");
+}
+
+TEST(POOLFUTURE, WhenAllFailsWithException)
+{
+    Thread_Pool pool(2);
+    std::vector<Pool_Future<void>> futures;
+    futures.push_back(post_async(pool, [](){}));
+    futures.push_back(post_async(pool, [](){ throw std::runtime_error("task failed"); }));
+    ASSERT_THROW(when_all(std::move(futures)).get(), std::runtime_error);
+}
+
+TEST(POOLFUTURE, WhenAnyReturnsFirstReady)
+{
+    Thread_Pool pool(2);
+    Pool_Promise<int> never_set(pool);
+    Pool_Promise<int> set_later(pool);
+    std::vector<Pool_Future<int>> futures;
+    futures.push_back(never_set.get_future());
+    futures.push_back(set_later.get_future());
+    auto fut = when_any(std::move(futures));
+    set_later.set_value(5);
+    When_Any_Result<int> result = fut.get();
+    ASSERT_EQ(result.index, 1);
+    ASSERT_EQ(result.value, 5);
+}
@@ -0,0 +1,570 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "concurrency/PriorityMutex.h"
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+using namespace NS_priority_mutex;
+
+namespace
+{
+struct Lock_Log
+{
+    std::mutex mut;
+    std::vector<int> order;
+};
+
+//Starts one thread per priority that locks mut, appends its index to OUT_order and unlocks.
+//Each thread is given time to queue up before the next one starts, so they queue in order.
+template<typename Mutex, typename Lock_Fn>
+std::vector<std::thread> queue_lockers(Mutex &mut, const std::vector<int> &priorities, std::vector<int> &OUT_order, Lock_Fn lock_fn)
+{
+    std::vector<std::thread> threads;
+    for(std::size_t thread_idx = 0; thread_idx < priorities.size(); ++thread_idx)
+    {
+        threads.emplace_back([&mut, &OUT_order, lock_fn, thread_idx, priority = priorities[thread_idx]]()
+        {
+            lock_fn(mut, priority);
+            OUT_order.push_back(static_cast<int>(thread_idx));
+            mut.unlock();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return threads;
+}
+
+//Like queue_lockers, for lockers that may share the lock: the log is synchronized, unlock_fn releases what lock_fn took,
+//and each holder keeps the lock for a moment so that lockers granted together overlap.
+template<typename Mutex, typename Lock_Fn, typename Unlock_Fn>
+std::vector<std::thread> queue_shared_lockers(Mutex &mut, const std::vector<int> &priorities, Lock_Log &OUT_log, Lock_Fn lock_fn, Unlock_Fn unlock_fn)
+{
+    std::vector<std::thread> threads;
+    for(std::size_t thread_idx = 0; thread_idx < priorities.size(); ++thread_idx)
+    {
+        threads.emplace_back([&mut, &OUT_log, lock_fn, unlock_fn, thread_idx, priority = priorities[thread_idx]]()
+        {
+            lock_fn(mut, priority, thread_idx);
+            {
+                std::lock_guard<std::mutex> lk(OUT_log.mut);
+                OUT_log.order.push_back(static_cast<int>(thread_idx));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            unlock_fn(mut, thread_idx);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return threads;
+}
+
+void join_all(std::vector<std::thread> &threads)
+{
+    for(std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+}
+
+TEST(PRIORITYMUTEX, MutualExclusion)
+{
+    Priority_Mutex mut;
+    long counter = 0;
+    std::vector<std::thread> threads;
+    for(int thread_idx = 0; thread_idx < 8; ++thread_idx)
+    {
+        threads.emplace_back([&mut, &counter, thread_idx]()
+        {
+            for(int i = 0; i < 10000; ++i)
+            {
+                mut.lock(DEFAULT_PRIORITY + (i + thread_idx) % 3);
+                ++counter;
+                mut.unlock();
+            }
+        });
+    }
+    for(std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_EQ(counter, 80000);
+}
+
+TEST(PRIORITYMUTEX, WaitersAreServedByPriorityThenFifo)
+{
+    Priority_Mutex mut;
+    std::vector<int> order;
+    mut.lock();
+    std::vector<std::thread> threads = queue_lockers(mut, {100, 200, 100, 50, 200}, order, [](Priority_Mutex &mut, int priority){ mut.lock(priority); });
+    mut.unlock();
+    for(std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_THAT(order, ElementsAre(1, 4, 0, 2, 3));
+}
+
+TEST(PRIORITYMUTEX, SpinConfigurations)
+{
+    for(const Spin_Config &config : {Spin_Config{0, true}, Spin_Config{64, false}, Spin_Config{}})
+    {
+        Priority_Mutex mut(config);
+        long counter = 0;
+        std::vector<std::thread> threads;
+        for(int thread_idx = 0; thread_idx < 4; ++thread_idx)
+        {
+            threads.emplace_back([&mut, &counter]()
+            {
+                for(int i = 0; i < 10000; ++i)
+                {
+                    mut.lock();
+                    ++counter;
+                    mut.unlock();
+                }
+            });
+        }
+        join_all(threads);
+        ASSERT_EQ(counter, 40000);
+        ASSERT_LE(mut.spin_budget(), config.max_spins);
+        if(std::thread::hardware_concurrency() == 1 || config.max_spins == 0)
+        {
+            ASSERT_EQ(mut.spin_budget(), 0u);
+        }
+        else if(!config.adaptive)
+        {
+            ASSERT_EQ(mut.spin_budget(), config.max_spins);
+        }
+    }
+}
+
+TEST(PRIORITYMUTEX, TryLockAndTimeouts)
+{
+    Priority_Mutex mut;
+    ASSERT_TRUE(mut.try_lock());
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_FALSE(mut.try_lock(200));
+        const auto start = std::chrono::steady_clock::now();
+        ASSERT_FALSE(mut.try_lock_for(std::chrono::milliseconds(20), 200));
+        ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+        ASSERT_FALSE(mut.try_lock_until(std::chrono::system_clock::now() + std::chrono::milliseconds(5)));
+    }).get();
+    mut.unlock();
+
+    //TimedLockable
+    std::unique_lock<Priority_Mutex> lk(mut, std::chrono::milliseconds(20));
+    ASSERT_TRUE(lk.owns_lock());
+}
+
+TEST(PRIORITYMUTEX, TimedOutWaiterLeavesQueue)
+{
+    Priority_Mutex mut;
+    std::vector<int> order;
+    mut.lock();
+    auto timed_out = std::async(std::launch::async, [&mut](){ return mut.try_lock_for(std::chrono::milliseconds(30), 200); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::vector<std::thread> threads = queue_lockers(mut, {50, 100}, order, [](Priority_Mutex &mut, int priority){ mut.lock(priority); });
+    ASSERT_FALSE(timed_out.get());
+    mut.unlock();
+    join_all(threads);
+    ASSERT_THAT(order, ElementsAre(1, 0));
+
+    //A waiter whose deadline does not pass gets the lock
+    mut.lock();
+    auto granted = std::async(std::launch::async, [&mut](){ return mut.try_lock_for(std::chrono::seconds(10)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mut.unlock();
+    ASSERT_TRUE(granted.get());
+    mut.unlock();
+}
+
+TEST(SHAREDPRIORITYMUTEX, ReadersNeverSeeHalfWrites)
+{
+    Shared_Priority_Mutex mut;
+    long first = 0;
+    long second = 0;
+    std::atomic_bool torn{false};
+    std::vector<std::thread> threads;
+    for(int thread_idx = 0; thread_idx < 8; ++thread_idx)
+    {
+        threads.emplace_back([&, thread_idx]()
+        {
+            for(int i = 0; i < 5000; ++i)
+            {
+                const int priority = DEFAULT_PRIORITY + (i + thread_idx) % 3;
+                if(thread_idx % 4 == 0)
+                {
+                    mut.lock(priority);
+                    ++first;
+                    ++second;
+                    mut.unlock();
+                }
+                else
+                {
+                    mut.lock_shared(priority);
+                    torn = torn || first != second;
+                    mut.unlock_shared();
+                }
+            }
+        });
+    }
+    join_all(threads);
+    ASSERT_FALSE(torn);
+    ASSERT_EQ(first, 10000);
+}
+
+TEST(SHAREDPRIORITYMUTEX, ReadersJoinUnlessOutrankedByWaiter)
+{
+    Shared_Priority_Mutex mut;
+    mut.lock_shared();
+    //No waiters: another reader joins right away
+    std::async(std::launch::async, [&mut](){ mut.lock_shared(50); mut.unlock_shared(); }).get();
+
+    std::thread writer([&mut](){ mut.lock(100); mut.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    //Outranks the queued writer
+    std::async(std::launch::async, [&mut](){ mut.lock_shared(150); mut.unlock_shared(); }).get();
+    //Has to wait behind the writer
+    auto low_reader = std::async(std::launch::async, [&mut](){ mut.lock_shared(50); mut.unlock_shared(); });
+    ASSERT_EQ(low_reader.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+    mut.unlock_shared();
+    writer.join();
+    low_reader.get();
+}
+
+TEST(SHAREDPRIORITYMUTEX, ReleaseGrantsAllReadersBeforeNextWriter)
+{
+    Shared_Priority_Mutex mut;
+    Lock_Log log;
+    const std::vector<bool> is_shared{true, false, true, false};
+    mut.lock();
+    std::vector<std::thread> threads = queue_shared_lockers(mut, {100, 200, 150, 50}, log,
+                                                     [&is_shared](Shared_Priority_Mutex &mut, int priority, std::size_t thread_idx)
+    {
+        is_shared[thread_idx] ? mut.lock_shared(priority) : mut.lock(priority);
+    },
+                                                     [&is_shared](Shared_Priority_Mutex &mut, std::size_t thread_idx)
+    {
+        is_shared[thread_idx] ? mut.unlock_shared() : mut.unlock();
+    });
+    mut.unlock();
+    join_all(threads);
+    ASSERT_THAT(log.order, ElementsAre(1, AnyOf(0, 2), AnyOf(0, 2), 3));
+}
+
+TEST(SHAREDPRIORITYMUTEX, TryLockAndTimeouts)
+{
+    Shared_Priority_Mutex mut;
+    ASSERT_TRUE(mut.try_lock_shared());
+    ASSERT_TRUE(mut.try_lock_shared(50));
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_FALSE(mut.try_lock());
+        ASSERT_FALSE(mut.try_lock_for(std::chrono::milliseconds(10), 200));
+        ASSERT_FALSE(mut.try_lock_until(std::chrono::system_clock::now() + std::chrono::milliseconds(5)));
+    }).get();
+    mut.unlock_shared();
+    mut.unlock_shared();
+
+    ASSERT_TRUE(mut.try_lock());
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_FALSE(mut.try_lock_shared(200));
+        ASSERT_FALSE(mut.try_lock_shared_for(std::chrono::milliseconds(10), 200));
+    }).get();
+    mut.unlock();
+
+    //SharedTimedLockable
+    std::shared_lock<Shared_Priority_Mutex> lk(mut, std::chrono::milliseconds(20));
+    ASSERT_TRUE(lk.owns_lock());
+}
+
+TEST(SHAREDPRIORITYMUTEX, TryLockSharedOutranksQueuedWriter)
+{
+    Shared_Priority_Mutex mut;
+    mut.lock_shared();
+    std::thread writer([&mut](){ mut.lock(100); mut.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_FALSE(mut.try_lock_shared(50));
+        ASSERT_TRUE(mut.try_lock_shared(150));
+        mut.unlock_shared();
+    }).get();
+    mut.unlock_shared();
+    writer.join();
+}
+
+TEST(SHAREDPRIORITYMUTEX, TimedOutWriterLetsReadersJoin)
+{
+    Shared_Priority_Mutex mut;
+    mut.lock_shared();
+    auto writer = std::async(std::launch::async, [&mut](){ return mut.try_lock_for(std::chrono::milliseconds(40), 200); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    //Queued behind the writer until it gives up, then joins the held shared lock
+    auto reader = std::async(std::launch::async, [&mut](){ mut.lock_shared(100); mut.unlock_shared(); });
+    ASSERT_EQ(reader.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+    ASSERT_FALSE(writer.get());
+    ASSERT_EQ(reader.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    mut.unlock_shared();
+}
+
+TEST(SHAREDPRIORITYMUTEX, DistributedReadersNeverSeeHalfWrites)
+{
+    Distributed_Shared_Priority_Mutex mut;
+    long first = 0;
+    long second = 0;
+    std::atomic_bool torn{false};
+    std::vector<std::thread> threads;
+    for(int thread_idx = 0; thread_idx < 8; ++thread_idx)
+    {
+        threads.emplace_back([&, thread_idx]()
+        {
+            for(int i = 0; i < 5000; ++i)
+            {
+                const int priority = DEFAULT_PRIORITY + (i + thread_idx) % 3;
+                if(thread_idx % 4 == 0 && i % 8 == 0)
+                {
+                    mut.lock(priority);
+                    ++first;
+                    ++second;
+                    mut.unlock();
+                }
+                else if(i % 2 == 0)
+                {
+                    mut.lock_shared(priority);
+                    torn = torn || first != second;
+                    mut.unlock_shared();
+                }
+                else if(mut.try_lock_shared_for(std::chrono::milliseconds(1), priority))
+                {
+                    torn = torn || first != second;
+                    mut.unlock_shared();
+                }
+            }
+        });
+    }
+    join_all(threads);
+    ASSERT_FALSE(torn);
+    ASSERT_EQ(first, 2 * 625);
+}
+
+TEST(SHAREDPRIORITYMUTEX, DistributedWriterRevokesReadBias)
+{
+    Distributed_Shared_Priority_Mutex mut;
+    ASSERT_TRUE(mut.read_biased());
+    mut.lock_shared();
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_FALSE(mut.try_lock());
+        ASSERT_FALSE(mut.try_lock_for(std::chrono::milliseconds(10)));
+    }).get();
+
+    auto writer = std::async(std::launch::async, [&mut](){ mut.lock(); mut.unlock(); });
+    ASSERT_EQ(writer.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+    mut.unlock_shared();
+    writer.get();
+    ASSERT_FALSE(mut.read_biased());
+
+    //Readers after the writer take the slow path until one of them restores the bias
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(!mut.read_biased() && std::chrono::steady_clock::now() < deadline)
+    {
+        mut.lock_shared();
+        mut.unlock_shared();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(mut.read_biased());
+}
+
+TEST(SHAREDPRIORITYMUTEX, DistributedNestedReadLockQueuesBehindRevokingWriter)
+{
+    Distributed_Shared_Priority_Mutex mut;
+    mut.lock_shared();
+    auto writer = std::async(std::launch::async, [&mut](){ mut.lock(); mut.unlock(); });
+    while(mut.read_biased())
+    {
+        std::this_thread::yield();
+    }
+    //The writer holds the underlying lock and waits for our read lock, so a nested lock_shared() would never return
+    ASSERT_FALSE(mut.try_lock_shared());
+    ASSERT_FALSE(mut.try_lock_shared_for(std::chrono::milliseconds(20)));
+    ASSERT_EQ(writer.wait_for(std::chrono::milliseconds(0)), std::future_status::timeout);
+    mut.unlock_shared();
+    writer.get();
+}
+
+TEST(SHAREDPRIORITYMUTEX, UpgradeLockJoinsReadersButExcludesWriters)
+{
+    Shared_Priority_Mutex mut;
+    mut.lock_upgrade();
+    std::async(std::launch::async, [&mut]()
+    {
+        ASSERT_TRUE(mut.try_lock_shared());
+        mut.unlock_shared();
+        ASSERT_FALSE(mut.try_lock());
+    }).get();
+    auto second_upgrader = std::async(std::launch::async, [&mut](){ mut.lock_upgrade(); mut.unlock_upgrade(); });
+    ASSERT_EQ(second_upgrader.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+    mut.unlock_upgrade();
+    second_upgrader.get();
+}
+
+TEST(SHAREDPRIORITYMUTEX, UpgradeKeepsPriorityWhileReadersLeave)
+{
+    Shared_Priority_Mutex mut;
+    Lock_Log log;
+    auto log_index = [&log](int index){ std::lock_guard<std::mutex> lk(log.mut); log.order.push_back(index); };
+    mut.lock_shared();
+
+    std::thread upgrader([&mut, &log_index]()
+    {
+        mut.lock_upgrade(150);
+        mut.unlock_upgrade_and_lock();
+        log_index(0);
+        mut.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread writer([&mut, &log_index](){ mut.lock(200); log_index(1); mut.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread low_reader([&mut, &log_index](){ mut.lock_shared(100); log_index(2); mut.unlock_shared(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    //Outranks the pending upgrade and the writer
+    std::async(std::launch::async, [&mut](){ mut.lock_shared(300); mut.unlock_shared(); }).get();
+    ASSERT_TRUE(log.order.empty());
+
+    mut.unlock_shared();
+    upgrader.join();
+    writer.join();
+    low_reader.join();
+    ASSERT_THAT(log.order, ElementsAre(0, 1, 2));
+}
+
+TEST(SHAREDPRIORITYMUTEX, DowngradesLetWaitersJoin)
+{
+    Shared_Priority_Mutex mut;
+    mut.lock();
+    auto reader = std::async(std::launch::async, [&mut](){ mut.lock_shared(); mut.unlock_shared(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mut.unlock_and_lock_shared();
+    ASSERT_EQ(reader.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    mut.unlock_shared();
+
+    mut.lock();
+    auto upgrader = std::async(std::launch::async, [&mut](){ mut.lock_upgrade(); mut.unlock_upgrade(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mut.unlock_and_lock_upgrade();
+    //Outranks the queued upgrader
+    std::async(std::launch::async, [&mut](){ ASSERT_TRUE(mut.try_lock_shared(150)); mut.unlock_shared(); }).get();
+    ASSERT_EQ(upgrader.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+    mut.unlock_upgrade_and_lock_shared();
+    ASSERT_EQ(upgrader.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    mut.unlock_shared();
+}
+
+TEST(SHAREDPRIORITYMUTEX, CheckThenModifyWithUpgrades)
+{
+    for(bool distributed : {false, true})
+    {
+        std::unique_ptr<Shared_Priority_Mutex> mut = distributed ? std::make_unique<Distributed_Shared_Priority_Mutex>()
+                                                                 : std::make_unique<Shared_Priority_Mutex>();
+        long value = 0;
+        long mirror = 0;
+        std::atomic_bool torn{false};
+        std::vector<std::thread> threads;
+        for(int thread_idx = 0; thread_idx < 6; ++thread_idx)
+        {
+            threads.emplace_back([&, thread_idx]()
+            {
+                for(int i = 0; i < 2000; ++i)
+                {
+                    const int priority = DEFAULT_PRIORITY + (i + thread_idx) % 3;
+                    if(thread_idx % 2 == 0)
+                    {
+                        mut->lock_upgrade(priority);
+                        //Only even values get incremented, without a second lookup after the upgrade
+                        if(value % 2 == 0 || i % 2 == 0)
+                        {
+                            mut->unlock_upgrade_and_lock();
+                            ++value;
+                            ++mirror;
+                            mut->unlock_and_lock_upgrade(priority);
+                        }
+                        torn = torn || value != mirror;
+                        mut->unlock_upgrade_and_lock_shared();
+                        mut->unlock_shared();
+                    }
+                    else
+                    {
+                        mut->lock_shared(priority);
+                        torn = torn || value != mirror;
+                        mut->unlock_shared();
+                    }
+                }
+            });
+        }
+        join_all(threads);
+        ASSERT_FALSE(torn);
+        ASSERT_EQ(value, mirror);
+        ASSERT_GE(value, 3000);
+    }
+}
+
+TEST(SHAREDPRIORITYMUTEX, StaticBiasAndPolicies)
+{
+    //Readers rank below writers by twice the bias
+    Basic_Shared_Priority_Mutex<50> biased;
+    biased.lock_shared();
+    std::thread writer([&biased](){ biased.lock(100); biased.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::async(std::launch::async, [&biased]()
+    {
+        ASSERT_FALSE(biased.try_lock_shared(199));
+        ASSERT_TRUE(biased.try_lock_shared(201));
+        biased.unlock_shared();
+    }).get();
+    biased.unlock_shared();
+    writer.join();
+
+    Basic_Shared_Priority_Mutex<0, Reader_Preference, Park> readers_first;
+    readers_first.lock_shared();
+    std::thread high_writer([&readers_first](){ readers_first.lock(500); readers_first.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::async(std::launch::async, [&readers_first](){ ASSERT_TRUE(readers_first.try_lock_shared(0)); readers_first.unlock_shared(); }).get();
+    ASSERT_EQ(readers_first.spin_budget(), 0u);
+    readers_first.unlock_shared();
+    high_writer.join();
+
+    Basic_Shared_Priority_Mutex<0, Writer_Preference> writers_first;
+    writers_first.lock_shared();
+    std::thread low_writer([&writers_first](){ writers_first.lock(0); writers_first.unlock(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::async(std::launch::async, [&writers_first](){ ASSERT_FALSE(writers_first.try_lock_shared(500)); }).get();
+    writers_first.unlock_shared();
+    low_writer.join();
+}
+
+namespace
+{
+struct Custom_Fairness
+{
+    [[nodiscard]] static constexpr bool may_join(int, int) noexcept { return true; }
+};
+
+template<typename Fairness_Policy, typename Wait_Policy>
+concept Instantiable_Policies = requires { typename Basic_Shared_Priority_Mutex<0, Fairness_Policy, Wait_Policy>; };
+}
+
+//Policies whose slow paths are not compiled into the library are rejected at compile time instead of failing to link
+static_assert(Instantiable_Policies<Writer_Preference, Park>);
+static_assert(!Instantiable_Policies<Custom_Fairness, Park>);
+static_assert(!Instantiable_Policies<Priority_Fairness, Custom_Fairness>);
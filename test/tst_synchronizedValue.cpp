@@ -1,7 +1,16 @@
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
 #include "concurrency/Synch_Value.h"
+#include "concurrency/Thread_Pool.h"
 
 using namespace testing;
 using namespace NS_dtools;
@@ -55,3 +64,525 @@ TEST(SYNCHRONIZEDVALUE, BlockingUpdateInOrderGetIsNextSetValue)
     ASSERT_EQ(val.get(), 199);
 }
 
+
+TEST(SYNCHRONIZEDVALUE, StaticMutexPolicy)
+{
+    Synch_Value<int, Basic_Shared_Priority_Mutex<1, Priority_Fairness, Park>> val(0, UPDATEINORDER);
+    for(int i = 0; i < 20; ++i)
+    {
+        val.set(i);
+    }
+    for(int i = 0; i < 20; ++i)
+    {
+        ASSERT_EQ(val.get(), i);
+    }
+}
+
+namespace
+{
+
+//Counts its copies, to check that the zero-copy accessors do not make any
+struct Copy_Counter
+{
+    Copy_Counter() = default;
+    explicit Copy_Counter(int IN_val) : val(IN_val) {}
+    Copy_Counter(const Copy_Counter &other) : val(other.val) { ++copies; }
+    Copy_Counter(Copy_Counter &&other) noexcept = default;
+    Copy_Counter& operator =(const Copy_Counter &other) { val = other.val; ++copies; return *this; }
+    Copy_Counter& operator =(Copy_Counter &&other) noexcept = default;
+
+    int val{0};
+    static inline std::atomic_int copies{0};
+};
+
+//Executor that only runs its tasks when asked to
+struct Manual_Executor
+{
+    template<typename Functor>
+    void post_free(Functor &&f)
+    {
+        tasks.emplace_back(std::forward<Functor>(f));
+    }
+    void run_all()
+    {
+        std::vector<std::move_only_function<void()>> to_run;
+        to_run.swap(tasks);
+        for(std::move_only_function<void()> &task : to_run)
+        {
+            task();
+        }
+    }
+    void drop_all() { tasks.clear(); } //Like an executor that is shut down with tasks still queued
+
+    std::vector<std::move_only_function<void()>> tasks;
+};
+
+struct Pair_Value
+{
+    long first{0};
+    long second{0};
+};
+
+//Readers hammer get() while one writer keeps setting new values. is_consistent must hold for every value a reader sees.
+template<typename T, typename Make_Fn, typename Check_Fn>
+void read_while_setting(Synch_Value<T> &val, Make_Fn make_value, Check_Fn is_consistent)
+{
+    std::atomic_bool done{false};
+    std::atomic_int torn_reads{0};
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            while(!done)
+            {
+                if(!is_consistent(val.get()))
+                {
+                    ++torn_reads;
+                }
+            }
+        });
+    }
+    for(int i = 1; i <= 20000; ++i)
+    {
+        val.set(make_value(i));
+    }
+    done = true;
+    for(std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    ASSERT_EQ(torn_reads, 0);
+}
+
+}
+
+TEST(SYNCHRONIZEDVALUE, LockFreeReadSmallValueNeverTears)
+{
+    static_assert(use_seqlock_v<Pair_Value>);
+    Synch_Value<Pair_Value> val(Pair_Value{}, LOCKFREEREAD);
+    read_while_setting(val, [](long i){ return Pair_Value{i, -i}; }, [](const Pair_Value &pair){ return pair.first == -pair.second; });
+    ASSERT_EQ(val.get().first, 20000);
+}
+
+TEST(SYNCHRONIZEDVALUE, LockFreeReadLargeValueNeverTears)
+{
+    static_assert(!use_seqlock_v<std::vector<int>>);
+    Synch_Value<std::vector<int>> val(std::vector<int>(64, 0), LOCKFREEREAD);
+    read_while_setting(val, [](int i){ return std::vector<int>(64, i); },
+                       [](const std::vector<int> &vec){ return std::all_of(vec.begin(), vec.end(), [&vec](int elem){ return elem == vec.front(); }); });
+    ASSERT_EQ(val.get().back(), 20000);
+}
+
+TEST(SYNCHRONIZEDVALUE, VisitAndPinDoNotCopy)
+{
+    for(int mode : {0x0, int(UPDATEINORDER), int(LOCKFREEREAD)})
+    {
+        Synch_Value<Copy_Counter> val(Copy_Counter(7), mode);
+        Copy_Counter::copies = 0;
+        ASSERT_EQ(val.visit([](const Copy_Counter &counter){ return counter.val; }), 7);
+        ASSERT_EQ(val.pin()->val, 7);
+        ASSERT_EQ(Copy_Counter::copies, 0);
+    }
+}
+
+TEST(SYNCHRONIZEDVALUE, PinnedSnapshotOutlivesSet)
+{
+    Synch_Value<std::vector<int>> val(std::vector<int>{1, 2, 3}, LOCKFREEREAD);
+    auto pinned = val.pin();
+    val.set(std::vector<int>{4});
+    ASSERT_THAT(*pinned, ElementsAre(1, 2, 3));
+    ASSERT_THAT(*val.pin(), ElementsAre(4));
+}
+
+TEST(SYNCHRONIZEDVALUE, PinnedSeqlockValueIsStoredInHandle)
+{
+    Synch_Value<Pair_Value> val(Pair_Value{1, 1}, LOCKFREEREAD);
+    auto pinned = val.pin();
+    val.set(Pair_Value{2, 2});
+    ASSERT_EQ(pinned->first, 1);
+    const auto *handle = reinterpret_cast<const char*>(&pinned);
+    const auto *pinned_val = reinterpret_cast<const char*>(pinned.get());
+    ASSERT_TRUE(pinned_val >= handle && pinned_val < handle + sizeof(pinned));
+}
+
+TEST(SYNCHRONIZEDVALUE, ModifyInPlace)
+{
+    for(int mode : {0x0, int(LOCKFREEREAD)})
+    {
+        Synch_Value<std::vector<int>> val(std::vector<int>{1}, mode);
+        val.modify([](std::vector<int> &vec){ vec.push_back(2); });
+        ASSERT_THAT(val.get(), ElementsAre(1, 2));
+    }
+    Synch_Value<Pair_Value> small_val(Pair_Value{1, 1}, LOCKFREEREAD);
+    small_val.modify([](Pair_Value &pair){ ++pair.second; });
+    ASSERT_EQ(small_val.get().second, 2);
+}
+
+TEST(SYNCHRONIZEDVALUE, ModifyUpdateInOrderChangesLatestValue)
+{
+    Synch_Value<int> val(0, UPDATEINORDER);
+    val.modify([](int &i){ i = 10; }); //Queue is empty, changes the active value
+    ASSERT_EQ(val.get(), 10);
+    val.set(1);
+    val.set(2);
+    val.modify([](int &i){ i *= 10; });
+    ASSERT_EQ(val.get(), 1);
+    ASSERT_EQ(val.get(), 20);
+    ASSERT_EQ(val.get(), 20);
+}
+
+TEST(SYNCHRONIZEDVALUE, ModifyOfDroppedValueIsDropped)
+{
+    Synch_Value<int> val(0, UPDATEINORDER, 2, Backpressure::Drop_Oldest);
+    val.set(1);
+    val.modify([](int &i){ i *= 10; });
+    val.set(2);
+    val.set(3);
+    ASSERT_EQ(val.get(), 2);
+    ASSERT_EQ(val.get(), 3);
+    ASSERT_EQ(val.get(), 3);
+}
+
+TEST(SYNCHRONIZEDVALUE, ModifyUpdateInOrderRacesWithReaders)
+{
+    constexpr long NUM_SETS = 20000;
+    constexpr long MODIFIED = 1000000;
+    Synch_Value<long> val(0, UPDATEINORDER, 16);
+    std::atomic_bool done{false};
+    std::thread reader([&val, &done]()
+    {
+        long last = 0;
+        while(!done)
+        {
+            const long current = val.get();
+            ASSERT_GE(current % MODIFIED, last % MODIFIED);
+            last = current;
+        }
+    });
+    for(long i = 1; i <= NUM_SETS; ++i)
+    {
+        val.set(long{i});
+        val.modify([](long &value){ value += MODIFIED; });
+    }
+    done = true;
+    reader.join();
+    //Whatever the reader took in between, the last value carries its modification
+    long last = 0;
+    for(int i = 0; i <= 16; ++i)
+    {
+        last = val.get();
+    }
+    ASSERT_EQ(last, NUM_SETS + MODIFIED);
+}
+
+TEST(SYNCHRONIZEDVALUE, ConcurrentModifiesAreNotLost)
+{
+    for(int mode : {0x0, int(LOCKFREEREAD)})
+    {
+        Synch_Value<long> val(0, mode);
+        std::vector<std::thread> writers;
+        for(int i = 0; i < 4; ++i)
+        {
+            writers.emplace_back([&val]()
+            {
+                for(int j = 0; j < 1000; ++j)
+                {
+                    val.modify([](long &counter){ ++counter; });
+                }
+            });
+        }
+        for(std::thread &writer : writers)
+        {
+            writer.join();
+        }
+        ASSERT_EQ(val.get(), 4000);
+    }
+}
+
+TEST(SYNCHRONIZEDVALUE, UpdateInOrderBackpressure)
+{
+    Synch_Value<int> failing(0, UPDATEINORDER, 4, Backpressure::Fail);
+    for(int i = 1; i <= 4; ++i)
+    {
+        ASSERT_TRUE(failing.set(i));
+    }
+    ASSERT_FALSE(failing.set(5));
+    ASSERT_EQ(failing.get(), 1);
+    ASSERT_TRUE(failing.set(5));
+
+    Synch_Value<int> dropping(0, UPDATEINORDER, 4, Backpressure::Drop_Oldest);
+    for(int i = 1; i <= 6; ++i)
+    {
+        ASSERT_TRUE(dropping.set(i));
+    }
+    for(int i = 3; i <= 6; ++i)
+    {
+        ASSERT_EQ(dropping.get(), i);
+    }
+    ASSERT_EQ(dropping.get(), 6);
+}
+
+TEST(SYNCHRONIZEDVALUE, UpdateInOrderBlockedSetResumesAfterGet)
+{
+    Synch_Value<int> val(0, UPDATEINORDER, 2, Backpressure::Block);
+    val.set(1);
+    val.set(2);
+    std::atomic_bool set_done{false};
+    std::thread setter([&]()
+    {
+        val.set(3);
+        set_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(set_done);
+    ASSERT_EQ(val.get(), 1);
+    setter.join();
+    ASSERT_EQ(val.get(), 2);
+    ASSERT_EQ(val.get(), 3);
+}
+
+TEST(SYNCHRONIZEDVALUE, UpdateInOrderBlockedSetHoldsTheOrder)
+{
+    Synch_Value<int> val(0, UPDATEINORDER, 2, Backpressure::Block);
+    val.set(1);
+    val.set(2);
+    Thread_Pool pool(1);
+    val.setAsync(pool, 3);
+    //Ordered after the blocked set, so it waits for the get() as well
+    auto modifier = std::async(std::launch::async, [&val](){ val.modify([](int &i){ i *= 10; }); });
+    ASSERT_EQ(modifier.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+    ASSERT_EQ(val.get(), 1);
+    modifier.get();
+    ASSERT_EQ(val.get(), 2);
+    ASSERT_EQ(val.get(), 30);
+}
+
+TEST(SYNCHRONIZEDVALUE, UpdateInOrderMovesValues)
+{
+    Synch_Value<Copy_Counter> val(Copy_Counter(0), UPDATEINORDER);
+    Copy_Counter::copies = 0;
+    for(int i = 1; i <= 10; ++i)
+    {
+        val.set(Copy_Counter(i));
+    }
+    for(int i = 1; i <= 10; ++i)
+    {
+        ASSERT_EQ(val.visit([](const Copy_Counter &counter){ return counter.val; }), i);
+    }
+    ASSERT_EQ(Copy_Counter::copies, 0);
+}
+
+TEST(SYNCHRONIZEDVALUE, UpdateInOrderConcurrentGetsLoseNoValue)
+{
+    constexpr int NUM_VALUES = 20000;
+    Synch_Value<int> val(0, UPDATEINORDER, 64, Backpressure::Block);
+    std::vector<std::atomic_bool> seen(NUM_VALUES + 1);
+    std::atomic_int num_seen{0};
+    std::atomic_int out_of_order{0};
+    std::vector<std::thread> getters;
+    for(int i = 0; i < 4; ++i)
+    {
+        getters.emplace_back([&]()
+        {
+            int last = 0;
+            while(num_seen < NUM_VALUES)
+            {
+                //On an empty queue get() returns the last value again, possibly one that another getter took
+                const int got = val.get();
+                if(got < last)
+                {
+                    ++out_of_order;
+                }
+                last = got;
+                if(got > 0 && !seen[got].exchange(true))
+                {
+                    ++num_seen;
+                }
+            }
+        });
+    }
+    for(int i = 1; i <= NUM_VALUES; ++i)
+    {
+        val.set(i);
+    }
+    for(std::thread &getter : getters)
+    {
+        getter.join();
+    }
+    ASSERT_EQ(out_of_order, 0);
+}
+
+TEST(SYNCHRONIZEDVALUE, SetAsyncMergesUnobservedSets)
+{
+    Manual_Executor executor;
+    Synch_Value<int> val(0);
+    for(int i = 1; i <= 100; ++i)
+    {
+        val.setAsync(executor, i);
+    }
+    ASSERT_EQ(executor.tasks.size(), 1);
+    ASSERT_EQ(val.get(), 0);
+    executor.run_all();
+    ASSERT_EQ(val.get(), 100);
+
+    //A set that was applied already is not merged with later ones
+    val.setAsync(executor, 101);
+    executor.run_all();
+    val.setAsync(executor, 102);
+    ASSERT_EQ(executor.tasks.size(), 1);
+    executor.run_all();
+    ASSERT_EQ(val.get(), 102);
+    ASSERT_TRUE(val.set(103));
+    ASSERT_EQ(val.get(), 103);
+}
+
+TEST(SYNCHRONIZEDVALUE, SetAsyncUpdateInOrderKeepsEveryValue)
+{
+    Manual_Executor executor;
+    Synch_Value<int> val(0, UPDATEINORDER);
+    for(int i = 1; i <= 10; ++i)
+    {
+        val.setAsync(executor, i);
+    }
+    ASSERT_EQ(executor.tasks.size(), 10);
+    executor.run_all();
+    for(int i = 1; i <= 10; ++i)
+    {
+        ASSERT_EQ(val.get(), i);
+    }
+}
+
+TEST(SYNCHRONIZEDVALUE, AsyncOnThreadPoolKeepsOrderWithSyncSets)
+{
+    Thread_Pool pool(4);
+    Synch_Value<int> val(0);
+    Synch_Value<int> ordered_val(0, UPDATEINORDER, 1024);
+    for(int i = 1; i <= 1000; ++i)
+    {
+        val.setAsync(pool, i);
+        ordered_val.setAsync(pool, i);
+    }
+    //Waits for all earlier async sets
+    val.set(1001);
+    ordered_val.set(1001);
+    ASSERT_EQ(val.getAsync(pool).get(), 1001);
+    for(int i = 1; i <= 1001; ++i)
+    {
+        ASSERT_EQ(ordered_val.getAsync(pool).get(), i);
+    }
+}
+
+TEST(SYNCHRONIZEDVALUE, DestructorWaitsForAsyncSets)
+{
+    Thread_Pool pool(2);
+    for(int run = 0; run < 100; ++run)
+    {
+        Synch_Value<std::vector<int>> val(std::vector<int>{});
+        for(int i = 0; i < 10; ++i)
+        {
+            val.setAsync(pool, std::vector<int>(100, i));
+        }
+    }
+}
+
+TEST(SYNCHRONIZEDVALUE, DroppedAsyncTasksDoNotBlock)
+{
+    for(int mode : {0x0, int(UPDATEINORDER)})
+    {
+        Manual_Executor executor;
+        Synch_Value<int> val(0, mode);
+        val.setAsync(executor, 1);
+        val.setAsync(executor, 2);
+        std::future<int> dropped_get = val.getAsync(executor);
+        executor.drop_all();
+        ASSERT_THROW(dropped_get.get(), std::future_error);
+        //The abandoned sets change nothing, and later writes do not wait for them
+        ASSERT_EQ(val.get(), 0);
+        ASSERT_EQ(val.version(), 0);
+        ASSERT_TRUE(val.set(3));
+        ASSERT_EQ(val.get(), 3);
+        val.setAsync(executor, 4);
+        executor.run_all();
+        ASSERT_EQ(val.get(), 4);
+    }
+
+    //A stopped pool destroys new tasks right away, the destructor of val must still return
+    Thread_Pool pool(1);
+    pool.stop();
+    Synch_Value<int> val(0);
+    val.setAsync(pool, 1);
+    ASSERT_THROW(val.getAsync(pool).get(), std::future_error);
+    val.modify([](int &i){ i += 2; });
+    ASSERT_EQ(val.get(), 2);
+}
+
+TEST(SYNCHRONIZEDVALUE, VersionCountsChanges)
+{
+    Synch_Value<int> val(0, UPDATEINORDER, 2, Backpressure::Fail);
+    ASSERT_EQ(val.version(), 0);
+    val.set(1);
+    val.modify([](int &i){ ++i; });
+    ASSERT_EQ(val.version(), 2);
+    val.set(2);
+    ASSERT_FALSE(val.set(3)); //Rejected sets change nothing
+    ASSERT_EQ(val.version(), 3);
+
+    Manual_Executor executor;
+    Synch_Value<int> merged(0);
+    for(int i = 1; i <= 10; ++i)
+    {
+        merged.setAsync(executor, i);
+    }
+    executor.run_all();
+    ASSERT_EQ(merged.version(), 1);
+}
+
+TEST(SYNCHRONIZEDVALUE, WaitForChangeWakesAllWatchers)
+{
+    Synch_Value<int> val(0);
+    std::atomic_int woken{0};
+    std::vector<std::thread> watchers;
+    for(int i = 0; i < 100; ++i)
+    {
+        watchers.emplace_back([&]()
+        {
+            std::uint64_t seen = val.version();
+            while(val.get() != 5)
+            {
+                seen = val.wait_for_change(seen);
+            }
+            ++woken;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(woken, 0);
+    for(int i = 1; i <= 5; ++i)
+    {
+        val.set(i);
+    }
+    for(std::thread &watcher : watchers)
+    {
+        watcher.join();
+    }
+    ASSERT_EQ(woken, 100);
+    ASSERT_EQ(val.wait_for_change(0), 5); //Returns at once if the version differs already
+}
+
+TEST(SYNCHRONIZEDVALUE, SubscribersAreCalledUntilUnsubscribed)
+{
+    Synch_Value<int> val(0, LOCKFREEREAD);
+    std::vector<std::uint64_t> first_versions;
+    std::vector<std::uint64_t> second_versions;
+    auto first = val.subscribe([&](std::uint64_t version){ first_versions.push_back(version); });
+    {
+        auto second = val.subscribe([&](std::uint64_t version){ second_versions.push_back(version); });
+        val.set(1);
+        val.modify([](int &i){ i += 10; });
+    }
+    val.set(2);
+    first.reset();
+    val.set(3);
+    ASSERT_THAT(first_versions, ElementsAre(1, 2, 3));
+    ASSERT_THAT(second_versions, ElementsAre(1, 2));
+}
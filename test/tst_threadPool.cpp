@@ -0,0 +1,707 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <numeric>
+#include <stdexcept>
+
+#include <DTools/concurrency/CPU_Topology.h>
+#include <DTools/concurrency/Latency_Histogram.h>
+#include <DTools/concurrency/Thread_Pool.h>
+#include <DTools/concurrency/Task_Group.h>
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+TEST(THREADPOOL, PostReturnsResult)
+{
+    Thread_Pool pool(4);
+    auto fut = pool.post([](int a, int b){ return a + b; }, 2, 3);
+    ASSERT_EQ(fut.get(), 5);
+}
+
+TEST(THREADPOOL, PostVoidFunctor)
+{
+    Thread_Pool pool(2);
+    std::atomic_int counter{0};
+    auto fut = pool.post([&counter](){ ++counter; });
+    fut.get();
+    ASSERT_EQ(counter, 1);
+}
+
+TEST(THREADPOOL, WaitForTasksDoneAfterPostFree)
+{
+    Thread_Pool pool(4);
+    std::atomic_int counter{0};
+    for(int i = 0; i < 1000; ++i)
+    {
+        pool.post_free([&counter](){ ++counter; });
+    }
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 1000);
+}
+
+TEST(THREADPOOL, NestedPostsAreExecuted)
+{
+    Thread_Pool pool(4);
+    std::atomic_int counter{0};
+    for(int i = 0; i < 50; ++i)
+    {
+        pool.post_free([&pool, &counter]()
+        {
+            for(int j = 0; j < 50; ++j)
+            {
+                pool.post_free([&counter](){ ++counter; });
+            }
+        });
+    }
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 2500);
+}
+
+TEST(THREADPOOL, JoinExecutesOutstandingTasks)
+{
+    std::atomic_int counter{0};
+    Thread_Pool pool(2);
+    for(int i = 0; i < 200; ++i)
+    {
+        pool.post_free([&counter](){ ++counter; });
+    }
+    pool.join();
+    ASSERT_EQ(counter, 200);
+}
+
+TEST(THREADPOOL, TasksPostedDuringStopAreDiscarded)
+{
+    for(int run = 0; run < 50; ++run)
+    {
+        Thread_Pool pool(0);
+        std::atomic_int posted{0};
+        std::thread poster([&pool, &posted]()
+        {
+            for(int i = 0; i < 2000; ++i)
+            {
+                pool.post_free([](){});
+                pool.post_free(200, [](){});
+                ++posted;
+            }
+        });
+        while(posted < 100)
+        {
+            std::this_thread::yield();
+        }
+        pool.stop();
+        poster.join();
+        //Hangs if a task arrived after the queues were drained
+        pool.wait_for_tasks_done();
+    }
+}
+
+TEST(THREADPOOL, AttachCurrentThreadRunsTasks)
+{
+    Thread_Pool pool(0);
+    std::atomic_int counter{0};
+    for(int i = 0; i < 100; ++i)
+    {
+        pool.post_free([&counter](){ ++counter; });
+    }
+    pool.post_free([&pool](){ pool.stop(); });
+    pool.attach_current_thread();
+    ASSERT_EQ(counter, 100);
+}
+
+TEST(THREADPOOL, PostMoveOnlyArgumentAndResult)
+{
+    Thread_Pool pool(2);
+    auto fut = pool.post([](std::unique_ptr<int> ptr){ *ptr += 1; return ptr; }, std::make_unique<int>(41));
+    std::unique_ptr<int> result = fut.get();
+    ASSERT_EQ(*result, 42);
+}
+
+TEST(THREADPOOL, PostPropagatesException)
+{
+    Thread_Pool pool(2);
+    auto fut = pool.post([](){ throw std::runtime_error("task failed"); });
+    ASSERT_THROW(fut.get(), std::runtime_error);
+}
+
+TEST(THREADPOOL, PoolTaskStoresSmallCallablesInline)
+{
+    int counter = 0;
+    Pool_Task small_task([&counter](){ ++counter; });
+    ASSERT_TRUE(small_task.is_inline());
+
+    std::array<char, 2 * Pool_Task::INLINE_CAPACITY> big_capture{};
+    Pool_Task big_task([&counter, big_capture](){ counter += big_capture.size(); });
+    ASSERT_FALSE(big_task.is_inline());
+
+    Pool_Task moved_task(std::move(small_task));
+    ASSERT_FALSE(small_task);
+    moved_task();
+    big_task();
+    ASSERT_EQ(counter, 1 + 2 * Pool_Task::INLINE_CAPACITY);
+}
+
+TEST(THREADPOOL, ParallelForVisitsEveryIndexOnce)
+{
+    Thread_Pool pool(4);
+    std::vector<std::atomic_int> visits(1000);
+    auto fut = pool.parallel_for(0, 1000, 7, [&visits](int idx){ ++visits[idx]; });
+    fut.get();
+    for(const auto &visit_count : visits)
+    {
+        ASSERT_EQ(visit_count, 1);
+    }
+}
+
+TEST(THREADPOOL, ParallelForEmptyRangeIsReady)
+{
+    Thread_Pool pool(2);
+    auto fut = pool.parallel_for(5, 5, 0, [](int){ FAIL(); });
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+}
+
+TEST(THREADPOOL, ParallelForPropagatesException)
+{
+    Thread_Pool pool(4);
+    auto fut = pool.parallel_for(0, 100, 1, [](int idx){ if(idx == 42) throw std::runtime_error("chunk failed"); });
+    ASSERT_THROW(fut.get(), std::runtime_error);
+}
+
+TEST(THREADPOOL, PostBulkFromWithinTask)
+{
+    Thread_Pool pool(4);
+    std::vector<int> values(500, 1);
+    auto fut = pool.post([&pool, &values]()
+    {
+        pool.post_bulk(values, [](int &val){ val *= 2; }).get();
+    });
+    fut.get();
+    ASSERT_EQ(std::accumulate(values.begin(), values.end(), 0), 1000);
+}
+
+TEST(THREADPOOL, TaskGroupWaitsOnlyForItsOwnTasks)
+{
+    Thread_Pool pool(2);
+    std::atomic_bool release_blocker{false};
+    Task_Group blocking_group(pool);
+    blocking_group.post_free([&release_blocker]()
+    {
+        while(!release_blocker)
+        {
+            std::this_thread::yield();
+        }
+    });
+
+    std::atomic_int counter{0};
+    {
+        Task_Group group(pool);
+        for(int i = 0; i < 100; ++i)
+        {
+            group.post_free([&counter](){ ++counter; });
+        }
+        group.wait();
+        ASSERT_TRUE(group.done());
+    }
+    ASSERT_EQ(counter, 100);
+    ASSERT_FALSE(blocking_group.done());
+
+    release_blocker = true;
+    blocking_group.wait();
+    ASSERT_TRUE(blocking_group.done());
+}
+
+TEST(THREADPOOL, TaskGroupPostReturnsResult)
+{
+    Thread_Pool pool(2);
+    Task_Group group(pool);
+    auto fut = group.post([](int val){ return val * 2; }, 21);
+    group.wait();
+    ASSERT_EQ(fut.get(), 42);
+}
+
+TEST(THREADPOOL, TaskGroupCompletesWhenPoolDiscardsTasks)
+{
+    Thread_Pool pool(0);
+    Task_Group group(pool);
+    group.post_free([](){});
+    pool.stop();
+    group.wait();
+    ASSERT_TRUE(group.done());
+}
+
+TEST(THREADPOOL, AttachThreadsToEmptyPool)
+{
+    Thread_Pool pool(0);
+    std::atomic_int counter{0};
+    for(int i = 0; i < 100; ++i)
+    {
+        pool.post_free([&counter](){ ++counter; });
+    }
+    pool.attach_threads(2);
+    ASSERT_EQ(pool.thread_count(), 2);
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 100);
+}
+
+TEST(THREADPOOL, DetachThreadsKeepsExecutingTasks)
+{
+    Thread_Pool pool(4);
+    pool.detach_threads(3);
+    ASSERT_EQ(pool.thread_count(), 1);
+
+    std::atomic_int counter{0};
+    for(int i = 0; i < 100; ++i)
+    {
+        pool.post_free([&counter](){ ++counter; });
+    }
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 100);
+
+    pool.detach_threads(10);
+    ASSERT_EQ(pool.thread_count(), 0);
+    pool.post_free([&counter](){ ++counter; });
+    pool.attach_threads(1);
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 101);
+}
+
+TEST(THREADPOOL, AutoScalingGrowsAndShrinks)
+{
+    Thread_Pool pool(1);
+    Thread_Pool::Auto_Scaling_Config config;
+    config.min_threads = 1;
+    config.max_threads = 3;
+    config.grow_queue_depth = 1;
+    config.grow_after = std::chrono::milliseconds(1);
+    config.shrink_after = std::chrono::milliseconds(20);
+    config.check_interval = std::chrono::milliseconds(1);
+    pool.enable_auto_scaling(config);
+
+    std::atomic_bool release_tasks{false};
+    for(int i = 0; i < 20; ++i)
+    {
+        pool.post_free([&release_tasks]()
+        {
+            while(!release_tasks)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(pool.thread_count() < 3 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(pool.thread_count(), 3);
+
+    release_tasks = true;
+    pool.wait_for_tasks_done();
+    while(pool.thread_count() > 1 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(pool.thread_count(), 1);
+}
+
+TEST(THREADPOOL, PrioritizedTasksRunFirst)
+{
+    Thread_Pool pool(0);
+    pool.set_priority_aging_interval(std::chrono::steady_clock::duration::zero());
+    std::vector<int> order;
+    pool.post_free(50, [&order](){ order.push_back(50); });
+    pool.post_free(200, [&order](){ order.push_back(200); });
+    pool.post_free([&order](){ order.push_back(NS_priority_mutex::DEFAULT_PRIORITY); });
+    pool.post_free(150, [&order](){ order.push_back(150); });
+    pool.post_free(-1000, [&pool](){ pool.stop(); });
+
+    const std::map<int, std::size_t> depths = pool.queue_depths();
+    ASSERT_EQ(depths.at(200), 1);
+    ASSERT_EQ(depths.at(NS_priority_mutex::DEFAULT_PRIORITY), 1);
+    ASSERT_EQ(depths.at(-1000), 1);
+
+    pool.attach_current_thread();
+    ASSERT_THAT(order, ElementsAre(200, 150, NS_priority_mutex::DEFAULT_PRIORITY, 50));
+}
+
+TEST(THREADPOOL, AgingLetsLowPriorityTasksOvertake)
+{
+    Thread_Pool pool(0);
+    pool.set_priority_aging_interval(std::chrono::milliseconds(1));
+    std::vector<int> order;
+    pool.post_free(0, [&order](){ order.push_back(0); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    pool.post_free(120, [&order](){ order.push_back(120); });
+    pool.post_free(-1000000, [&pool](){ pool.stop(); });
+
+    pool.attach_current_thread();
+    ASSERT_THAT(order, ElementsAre(0, 120));
+}
+
+TEST(THREADPOOL, PostWithPriorityReturnsResult)
+{
+    Thread_Pool pool(2);
+    auto fut = pool.post(500, [](int val){ return val + 1; }, 1);
+    ASSERT_EQ(fut.get(), 2);
+}
+
+TEST(THREADPOOL, PostAfterRunsAfterDelay)
+{
+    Thread_Pool pool(2);
+    std::promise<std::chrono::steady_clock::time_point> ran_at;
+    const auto posted_at = std::chrono::steady_clock::now();
+    pool.post_after(std::chrono::milliseconds(20), [&ran_at](){ ran_at.set_value(std::chrono::steady_clock::now()); });
+    ASSERT_GE(ran_at.get_future().get() - posted_at, std::chrono::milliseconds(20));
+}
+
+TEST(THREADPOOL, CancelledTimersDoNotRun)
+{
+    Thread_Pool pool(2);
+    std::atomic_int counter{0};
+    std::vector<Thread_Pool::Timer_Handle> handles;
+    for(int i = 0; i < 10000; ++i)
+    {
+        //The cancelled half is due far in the future, so cancel() cannot race with its deadline
+        const auto delay = (i % 2 == 0) ? std::chrono::milliseconds(std::chrono::hours(1)) : std::chrono::milliseconds(1 + i % 100);
+        handles.push_back(pool.post_after(delay, [&counter](){ ++counter; }));
+    }
+    for(std::size_t idx = 0; idx < handles.size(); idx += 2)
+    {
+        ASSERT_TRUE(handles[idx].cancel());
+        ASSERT_FALSE(handles[idx].pending());
+    }
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(counter < 5000 && std::chrono::steady_clock::now() < give_up)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(counter, 5000);
+    ASSERT_FALSE(handles[1].pending());
+    ASSERT_FALSE(handles[1].cancel());
+    ASSERT_FALSE(handles[0].cancel());
+}
+
+TEST(THREADPOOL, PostEveryRepeatsUntilCancelled)
+{
+    Thread_Pool pool(2);
+    std::atomic_int counter{0};
+    Thread_Pool::Timer_Handle handle = pool.post_every(std::chrono::milliseconds(2), [&counter](){ ++counter; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(counter < 5 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(handle.cancel());
+    pool.wait_for_tasks_done();
+    const int runs = counter;
+    ASSERT_GE(runs, 5);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(counter, runs);
+}
+
+TEST(THREADPOOL, CancelledTasksAreDroppedWithoutRunning)
+{
+    Thread_Pool pool(0);
+    std::atomic_int counter{0};
+    Thread_Pool::Task_Handle cancelled = pool.post_cancellable([&counter](){ ++counter; });
+    Thread_Pool::Task_Handle kept = pool.post_cancellable([&counter](){ ++counter; });
+    std::stop_source upstream;
+    Thread_Pool::Task_Options options;
+    options.stop_token = upstream.get_token();
+    Thread_Pool::Task_Handle cancelled_upstream = pool.post_cancellable(options, [&counter](){ ++counter; });
+    options = Thread_Pool::Task_Options{};
+    options.deadline = std::chrono::steady_clock::now();
+    Thread_Pool::Task_Handle expired = pool.post_cancellable(options, [&counter](){ ++counter; });
+
+    ASSERT_TRUE(cancelled.cancel());
+    upstream.request_stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pool.post_free(-1000, [&pool](){ pool.stop(); });
+    pool.attach_current_thread();
+
+    ASSERT_EQ(counter, 1);
+    ASSERT_EQ(cancelled.status(), Thread_Pool::Task_Status::Cancelled);
+    ASSERT_EQ(kept.status(), Thread_Pool::Task_Status::Finished);
+    ASSERT_EQ(cancelled_upstream.status(), Thread_Pool::Task_Status::Cancelled);
+    ASSERT_EQ(expired.status(), Thread_Pool::Task_Status::Expired);
+    ASSERT_FALSE(kept.cancel());
+}
+
+TEST(THREADPOOL, RunningTaskSeesStopRequest)
+{
+    Thread_Pool pool(1);
+    std::promise<void> started;
+    Thread_Pool::Task_Handle handle = pool.post_cancellable([&started](std::stop_token stop_token, int max_rounds)
+    {
+        started.set_value();
+        for(int round = 0; round < max_rounds && !stop_token.stop_requested(); ++round)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }, 10000);
+    started.get_future().get();
+    ASSERT_FALSE(handle.cancel());
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(handle.status(), Thread_Pool::Task_Status::Finished);
+}
+
+TEST(THREADPOOL, ThrowingCancellableTaskFails)
+{
+    Thread_Pool pool(1);
+    Thread_Pool::Task_Handle handle = pool.post_cancellable([](){ throw std::runtime_error("task failed"); });
+    pool.wait_for_tasks_done();
+    ASSERT_EQ(handle.status(), Thread_Pool::Task_Status::Failed);
+    ASSERT_THROW(std::rethrow_exception(handle.exception()), std::runtime_error);
+    ASSERT_FALSE(handle.cancel());
+
+    //The worker survived
+    ASSERT_EQ(pool.post([](){ return 1; }).get(), 1);
+}
+
+TEST(THREADPOOL, StopDiscardsCancellableTasks)
+{
+    Thread_Pool pool(0);
+    Thread_Pool::Task_Handle handle = pool.post_cancellable([](){});
+    pool.stop();
+    ASSERT_EQ(handle.status(), Thread_Pool::Task_Status::Discarded);
+}
+
+TEST(THREADPOOL, LatencyHistogramBuckets)
+{
+    Latency_Histogram histogram;
+    histogram.record(std::chrono::nanoseconds(0));
+    histogram.record(std::chrono::nanoseconds(1));
+    histogram.record(std::chrono::nanoseconds(1000));
+    histogram.record(std::chrono::milliseconds(5));
+    const Latency_Histogram::Snapshot snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.count(), 4);
+    ASSERT_EQ(snapshot.buckets[0], 1);
+    ASSERT_EQ(snapshot.buckets[1], 1);
+    ASSERT_EQ(snapshot.buckets[Latency_Histogram::bucket_index(std::chrono::nanoseconds(1000))], 1);
+    ASSERT_GE(snapshot.quantile(1.0), std::chrono::milliseconds(5));
+    ASSERT_LT(snapshot.quantile(0.5), std::chrono::microseconds(1));
+}
+
+#ifdef DT_POOL_METRICS
+TEST(THREADPOOL, MetricsCountExecutedTasks)
+{
+    Thread_Pool pool(2);
+    for(int i = 0; i < 100; ++i)
+    {
+        pool.post_free([](){ std::this_thread::sleep_for(std::chrono::microseconds(10)); });
+    }
+    pool.wait_for_tasks_done();
+
+    const Thread_Pool::Metrics metrics = pool.metrics();
+    ASSERT_EQ(metrics.workers.size(), 2);
+    std::uint64_t executed = 0;
+    for(const Thread_Pool::Worker_Metrics &worker : metrics.workers)
+    {
+        executed += worker.tasks_executed;
+        ASSERT_EQ(worker.queue_depth, 0);
+    }
+    ASSERT_EQ(executed, 100);
+    ASSERT_EQ(metrics.queue_latency.count(), 100);
+    ASSERT_EQ(metrics.run_latency.count(), 100);
+    ASSERT_GE(metrics.run_latency.quantile(0.5), std::chrono::microseconds(10));
+}
+#endif
+
+TEST(THREADPOOL, ParseCpuList)
+{
+    ASSERT_THAT(CPU_Topology::parse_cpu_list("0-3,8,10-11\n"), ElementsAre(0, 1, 2, 3, 8, 10, 11));
+    ASSERT_TRUE(CPU_Topology::parse_cpu_list("").empty());
+    ASSERT_THROW((void)CPU_Topology::parse_cpu_list("3-1"), NS_misc::BaseOmegaException);
+    ASSERT_THROW((void)CPU_Topology::parse_cpu_list("0,a"), NS_misc::BaseOmegaException);
+}
+
+namespace
+{
+//Writes root/devices/system/{cpu/online,node/node<idx>/cpulist}
+void write_fake_sysfs(const std::filesystem::path &root, const std::string &online, const std::vector<std::string> &node_cpu_lists)
+{
+    std::filesystem::remove_all(root);
+    const std::filesystem::path system_dir = root / "devices" / "system";
+    std::filesystem::create_directories(system_dir / "cpu");
+    std::ofstream(system_dir / "cpu" / "online") << online << '\n';
+    for(std::size_t node_idx = 0; node_idx < node_cpu_lists.size(); ++node_idx)
+    {
+        const std::filesystem::path node_dir = system_dir / "node" / ("node" + std::to_string(node_idx));
+        std::filesystem::create_directories(node_dir);
+        std::ofstream(node_dir / "cpulist") << node_cpu_lists[node_idx] << '\n';
+    }
+}
+}
+
+TEST(THREADPOOL, TopologyFromSysfs)
+{
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "dt_tst_sysfs";
+    write_fake_sysfs(root, "0-2", {"0-1", "2-3", ""}); //CPU 3 is offline, node 2 has memory only
+    const CPU_Topology topology = CPU_Topology::from_sysfs(root);
+    std::filesystem::remove_all(root);
+
+    ASSERT_EQ(topology.nodes().size(), 2);
+    ASSERT_EQ(topology.nodes()[0].id, 0);
+    ASSERT_THAT(topology.nodes()[0].cpus, ElementsAre(0, 1));
+    ASSERT_EQ(topology.nodes()[1].id, 1);
+    ASSERT_THAT(topology.nodes()[1].cpus, ElementsAre(2));
+    ASSERT_EQ(topology.cpu_count(), 3);
+    ASSERT_EQ(topology.node_of_cpu(2), 1);
+    ASSERT_EQ(topology.node_of_cpu(3), -1);
+    ASSERT_TRUE(CPU_Topology::from_sysfs(root).nodes().empty());
+}
+
+namespace
+{
+//Two fake nodes that both consist of the CPU this thread runs on, so pinning succeeds on any machine
+Thread_Pool::Placement_Config two_node_placement(int cpu)
+{
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "dt_tst_sysfs_pool";
+    write_fake_sysfs(root, std::to_string(cpu), {std::to_string(cpu), std::to_string(cpu)});
+    Thread_Pool::Placement_Config placement;
+    placement.numa_groups = true;
+    placement.topology = CPU_Topology::from_sysfs(root);
+    std::filesystem::remove_all(root);
+    return placement;
+}
+
+//Occupies every worker of pool. Returns when all of them are occupied and have run prepare(node of the worker),
+//which returns the key under which release() lets that worker go.
+struct Worker_Blockade
+{
+    template<typename Prepare_Fn>
+    Worker_Blockade(Thread_Pool &pool, std::ptrdiff_t num_workers, Prepare_Fn prepare)
+    :   all_occupied(num_workers), all_prepared(num_workers + 1)
+    {
+        for(std::ptrdiff_t i = 0; i < num_workers; ++i)
+        {
+            pool.post_free([this, prepare]()
+            {
+                all_occupied.arrive_and_wait();
+                const int key = prepare(Thread_Pool::current_node());
+                all_prepared.arrive_and_wait();
+                released[key].wait(false);
+            });
+        }
+        all_prepared.arrive_and_wait();
+    }
+    void release(int key)
+    {
+        released[key] = true;
+        released[key].notify_all();
+    }
+
+    std::latch all_occupied;
+    std::latch all_prepared;
+    std::array<std::atomic_bool, 3> released{};
+};
+
+//Appends the node of the worker that runs the task and the origin given at post time
+struct Run_Log
+{
+    explicit Run_Log(std::ptrdiff_t num_tasks) : all_recorded(num_tasks) {}
+    void record(int origin)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mut);
+            entries.emplace_back(Thread_Pool::current_node(), origin);
+        }
+        all_recorded.count_down();
+    }
+
+    std::latch all_recorded;
+    std::mutex mut;
+    std::vector<std::pair<int, int>> entries; //(node that ran the task, origin)
+};
+}
+
+TEST(THREADPOOL, NumaGroupsArePinnedAndTakeNodeTasks)
+{
+    const int cpu = current_cpu();
+    ASSERT_GE(cpu, 0);
+    Thread_Pool::Placement_Config placement = two_node_placement(cpu);
+
+    Thread_Pool pool(4, placement);
+    ASSERT_THAT(pool.numa_nodes(), ElementsAre(0, 1));
+    ASSERT_EQ(Thread_Pool::current_node(), -1);
+    std::vector<std::future<int>> cpus;
+    for(int i = 0; i < 20; ++i)
+    {
+        cpus.push_back(pool.post_on_node(i % 2, [](){ return current_cpu(); }));
+        cpus.push_back(pool.post_on_node(7, [](){ return current_cpu(); })); //no such node, posted normally
+    }
+    for(std::future<int> &fut : cpus)
+    {
+        ASSERT_EQ(fut.get(), cpu);
+    }
+
+    placement.cpus = {cpu + 1};
+    ASSERT_THROW(Thread_Pool(1, placement), NS_misc::BaseOmegaException);
+}
+
+TEST(THREADPOOL, NumaGroupTakesItsOwnNodeTasksFirst)
+{
+    constexpr int NUM_TASKS = 10;
+    Thread_Pool pool(2, two_node_placement(current_cpu())); //One worker per node
+    Worker_Blockade blockade(pool, 2, [](int node){ return node; });
+    Run_Log log(2 * NUM_TASKS);
+    std::vector<std::future<void>> done;
+    for(int i = 0; i < NUM_TASKS; ++i)
+    {
+        done.push_back(pool.post_on_node(0, [&log](){ log.record(0); }));
+        done.push_back(pool.post_on_node(1, [&log](){ log.record(1); }));
+    }
+    //The worker of node 1 runs alone: its own inbox first, then the inbox of node 0
+    blockade.release(1);
+    log.all_recorded.wait();
+    blockade.release(0);
+    pool.wait_for_tasks_done();
+
+    for(int i = 0; i < 2 * NUM_TASKS; ++i)
+    {
+        ASSERT_EQ(log.entries[i].first, 1);
+        ASSERT_EQ(log.entries[i].second, i < NUM_TASKS ? 1 : 0);
+    }
+}
+
+TEST(THREADPOOL, NumaGroupStealsWithinItsNodeFirst)
+{
+    constexpr int NUM_TASKS = 10;
+    Thread_Pool pool(3, two_node_placement(current_cpu())); //Two workers on node 0, one on node 1
+    Run_Log log(2 * NUM_TASKS);
+    std::array<std::atomic_int, 2> node_arrivals{};
+    std::array<std::vector<std::future<void>>, 2> done;
+    //One worker per node fills its own deque and stays blocked, the second worker of node 0 is released (key 2)
+    Worker_Blockade blockade(pool, 3, [&pool, &log, &node_arrivals, &done](int node)
+    {
+        if(node_arrivals[node]++ != 0)
+        {
+            return 2;
+        }
+        for(int i = 0; i < NUM_TASKS; ++i)
+        {
+            //Posted from a worker of the node, so it goes to the worker's own deque
+            done[node].push_back(pool.post_on_node(node, [&log, node](){ log.record(node); }));
+        }
+        return node;
+    });
+    ASSERT_EQ(node_arrivals[0], 2);
+    //The released worker steals from its neighbour on node 0 before it crosses to node 1
+    blockade.release(2);
+    log.all_recorded.wait();
+    blockade.release(0);
+    blockade.release(1);
+    pool.wait_for_tasks_done();
+
+    for(int i = 0; i < 2 * NUM_TASKS; ++i)
+    {
+        ASSERT_EQ(log.entries[i].first, 0);
+        ASSERT_EQ(log.entries[i].second, i < NUM_TASKS ? 0 : 1);
+    }
+}
@@ -0,0 +1,65 @@
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <DTools/concurrency/Timer_Wheel.h>
+
+using namespace testing;
+using namespace NS_dtools;
+using namespace NS_concurrency;
+
+using Wheel = Timer_Wheel<int>;
+
+TEST(TIMERWHEEL, ExpiresEveryTimerOnItsTickAcrossLevels)
+{
+    const Wheel::clock::time_point start{};
+    Wheel wheel(std::chrono::milliseconds(1), start);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> deadline_dist(1, 300000);
+    std::vector<int> deadlines_ms(2000);
+    for(std::size_t idx = 0; idx < deadlines_ms.size(); ++idx)
+    {
+        deadlines_ms[idx] = deadline_dist(rng);
+        (void)wheel.insert(start + std::chrono::milliseconds(deadlines_ms[idx]), static_cast<int>(idx));
+    }
+    ASSERT_EQ(wheel.size(), deadlines_ms.size());
+
+    std::vector<Wheel::Node_Ptr> expired;
+    std::size_t num_expired = 0;
+    for(int now_ms = 1; now_ms <= 300000; now_ms += 7)
+    {
+        wheel.advance(start + std::chrono::milliseconds(now_ms), expired);
+        for(const Wheel::Node_Ptr &node : expired)
+        {
+            //Never early and at most one advance() step late
+            ASSERT_LE(deadlines_ms[node->element], now_ms);
+            ASSERT_GT(deadlines_ms[node->element], now_ms - 7);
+        }
+        num_expired += expired.size();
+        expired.clear();
+    }
+    wheel.advance(start + std::chrono::milliseconds(300000), expired);
+    ASSERT_EQ(num_expired + expired.size(), deadlines_ms.size());
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TIMERWHEEL, EraseAndFarDeadlines)
+{
+    const Wheel::clock::time_point start{};
+    Wheel wheel(std::chrono::milliseconds(1), start);
+    Wheel::Node_Ptr erased = wheel.insert(start + std::chrono::milliseconds(10), 1);
+    Wheel::Node_Ptr far = wheel.insert(start + std::chrono::hours(10), 2);
+    ASSERT_TRUE(wheel.erase(erased));
+    ASSERT_FALSE(wheel.erase(erased));
+    ASSERT_EQ(wheel.size(), 1);
+
+    std::vector<Wheel::Node_Ptr> expired;
+    wheel.advance(start + std::chrono::hours(10) - std::chrono::milliseconds(1), expired);
+    ASSERT_TRUE(expired.empty());
+    ASSERT_TRUE(far->scheduled());
+    wheel.advance(start + std::chrono::hours(10), expired);
+    ASSERT_EQ(expired.size(), 1);
+    ASSERT_EQ(expired.front()->element, 2);
+    ASSERT_FALSE(wheel.next_wakeup().has_value());
+}